@@ -28,9 +28,11 @@ it freely, subject to the following restrictions:
 *********************************************************************/
 
 /*
-Demonstrates adding and removing objects to an object layer dynamically.
-Note that this is not the preferred method, and that this example only
-exists by request.
+Demonstrates adding and removing objects dynamically. Objects are kept
+in a list so that they stay at the same address while the map loader
+refers to them, and are registered with addObject() and removeObject()
+rather than modifying a loaded layer's objects, which the map loader's
+object index and quad tree point in to.
 */
 
 #include <SFML/System.hpp>
@@ -39,14 +41,16 @@ exists by request.
 #include <tmx/MapLoader.hpp>
 
 #include <sstream>
+#include <list>
 #include <cassert>
 
-void AddObject(tmx::MapLayer& layer, const sf::Vector2f& coords)
+void AddObject(tmx::MapLoader& ml, std::list<tmx::MapObject>& objects, const sf::Vector2f& coords)
 {
 	const float width = 32.f;
 	const float height = 64.f;
 	
-	tmx::MapObject mo;
+	objects.emplace_back();
+	auto& mo = objects.back();
 	mo.setPosition(coords);
 	mo.addPoint(sf::Vector2f());
 	mo.addPoint(sf::Vector2f(width, 0.f));
@@ -55,7 +59,7 @@ void AddObject(tmx::MapLayer& layer, const sf::Vector2f& coords)
 	mo.createDebugShape(sf::Color::Magenta); //must always call this after adding points
 											//to properly create bounding properties.
 
-	layer.objects.push_back(mo);
+	ml.addObject(mo);
 }
 
 
@@ -71,7 +75,8 @@ int main()
 	sf::Clock deltaClock, frameClock;
 
 	assert(ml.getLayers().size() > 1);
-	auto& objectLayer = ml.getLayers()[1];
+	const auto& objectLayer = ml.getLayers()[1];
+	std::list<tmx::MapObject> objects;
 
 
 	//-----------------------------------//
@@ -93,10 +98,10 @@ int main()
 					renderWindow.close();
 					break;
 				case sf::Keyboard::D:
-					if(objectLayer.objects.size())
+					if(!objects.empty())
 					{
-						//objectLayer.objects.pop_back();
-						objectLayer.objects.erase(objectLayer.objects.end() - 1);
+						ml.removeObject(objects.back());
+						objects.pop_back();
 					}
 					break;
 				default: break;
@@ -110,7 +115,7 @@ int main()
 				case sf::Mouse::Left:
 					{
 					sf::Vector2f mousePos = renderWindow.mapPixelToCoords(sf::Mouse::getPosition(renderWindow));
-					AddObject(objectLayer, mousePos);
+					AddObject(ml, objects, mousePos);
 					}
 					break;
 				default: break;
@@ -124,6 +129,8 @@ int main()
 		renderWindow.clear();
 		renderWindow.draw(ml);
 		ml.drawLayer(renderWindow, tmx::MapLayer::Debug);
+		for(const auto& object : objects)
+			object.drawDebugShape(renderWindow, objectLayer.getTransform());
 		renderWindow.display();
 
 		const float time = 1.f / frameClock.getElapsedTime().asSeconds();
@@ -0,0 +1,214 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+The zlib license has been used to make this software fully compatible
+with SFML. See http://www.sfml-dev.org/license.php
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+
+//Headless stress test for concurrent spatial queries. Loads a map and builds a quad tree and
+//then a grid over it. A set of area queries, raycasts and line of sight tests is run once on
+//the main thread to record the expected results, then run repeatedly on several threads at
+//once against the same MapLoader, checking that every thread sees the same results. Each
+//thread gathers its own query stats. Build with -fsanitize=thread, for example by configuring
+//with -DCMAKE_CXX_FLAGS=-fsanitize=thread, to have ThreadSanitizer report any data races.
+//
+//usage: ConcurrentQueries [--threads n] [--queries n] [--rounds n] [maps/map.tmx | WxH]
+//
+//a synthetic map of the given size in tiles is generated with tmx::MapGenerator if no .tmx is given
+
+#include <tmx/MapLoader.hpp>
+#include <tmx/MapGenerator.hpp>
+#include <tmx/Log.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+
+namespace
+{
+	struct Expected
+	{
+		std::vector<std::vector<tmx::MapObject*>> objects; //found by each area query
+		std::vector<tmx::MapObject*> hits; //object hit by each ray, or null
+		std::vector<sf::Uint8> visible; //line of sight along each ray
+	};
+
+	struct ThreadResult
+	{
+		ThreadResult() : mismatches(0u){}
+		std::size_t mismatches;
+		tmx::SpatialQueryStats stats;
+	};
+
+	//runs every query rounds times, starting at a different query on each thread
+	void runQueries(const tmx::MapLoader& ml, const std::vector<sf::FloatRect>& areas, const Expected& expected,
+		std::size_t first, std::size_t rounds, ThreadResult& result)
+	{
+		std::vector<tmx::MapObject*> found;
+		tmx::RaycastHit hit;
+		for(auto round = 0u; round < rounds; ++round)
+		{
+			for(auto j = 0u; j < areas.size(); ++j)
+			{
+				const std::size_t i = (first + j) % areas.size();
+				const sf::FloatRect& area = areas[i];
+				ml.queryQuadTree(area, found, tmx::SpatialQuery::Overlapping, &result.stats);
+				if(found != expected.objects[i]) result.mismatches++;
+
+				const sf::Vector2f start(area.left, area.top);
+				const sf::Vector2f end(area.left + area.width, area.top + area.height);
+				tmx::MapObject* object = ml.raycast(start, end, hit) ? hit.object : nullptr;
+				if(object != expected.hits[i]) result.mismatches++;
+				if(ml.lineOfSight(start, end) != (expected.visible[i] != 0u)) result.mismatches++;
+			}
+		}
+	}
+
+	bool runIndex(const tmx::MapLoader& ml, const std::vector<sf::FloatRect>& areas, std::size_t threadCount, std::size_t rounds)
+	{
+		//expected results, from a single thread
+		Expected expected;
+		expected.objects.resize(areas.size());
+		std::vector<sf::Vector2f> starts, ends;
+		tmx::RaycastHit hit;
+		for(auto i = 0u; i < areas.size(); ++i)
+		{
+			const sf::FloatRect& area = areas[i];
+			ml.queryQuadTree(area, expected.objects[i], tmx::SpatialQuery::Overlapping);
+			starts.emplace_back(area.left, area.top);
+			ends.emplace_back(area.left + area.width, area.top + area.height);
+			expected.hits.push_back(ml.raycast(starts.back(), ends.back(), hit) ? hit.object : nullptr);
+		}
+		ml.lineOfSight(starts.data(), ends.data(), areas.size(), expected.visible);
+
+		//the same queries on every thread at once
+		std::vector<ThreadResult> results(threadCount);
+		std::vector<std::thread> threads;
+		for(auto i = 0u; i < threadCount; ++i)
+		{
+			threads.emplace_back(runQueries, std::cref(ml), std::cref(areas), std::cref(expected),
+				i * areas.size() / threadCount, rounds, std::ref(results[i]));
+		}
+		for(auto& thread : threads)
+			thread.join();
+
+		//and a batch split over the threads
+		std::size_t mismatches = 0u;
+		std::vector<sf::Uint8> visible;
+		ml.lineOfSight(starts.data(), ends.data(), areas.size(), visible, static_cast<sf::Uint32>(threadCount));
+		if(visible != expected.visible) mismatches++;
+
+		tmx::BatchQueryResults batch;
+		ml.queryQuadTree(areas.data(), areas.size(), batch, tmx::SpatialQuery::Overlapping, static_cast<sf::Uint32>(threadCount));
+		for(auto i = 0u; i < areas.size(); ++i)
+		{
+			if(!std::equal(expected.objects[i].begin(), expected.objects[i].end(), batch.begin(i))
+				|| expected.objects[i].size() != batch.count(i)) mismatches++;
+		}
+
+		for(auto i = 0u; i < threadCount; ++i)
+		{
+			const auto& result = results[i];
+			std::cout << "  thread " << i << ": " << result.stats.nodesVisited << " nodes visited, "
+				<< result.stats.objectsTested << " objects tested, max depth " << result.stats.maxDepth
+				<< ", " << result.mismatches << " mismatches" << std::endl;
+			mismatches += result.mismatches;
+		}
+		std::cout << "  " << mismatches << " mismatches in total" << std::endl;
+		return (mismatches == 0u);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	tmx::setLogLevel(tmx::Logger::Error);
+
+	std::size_t threadCount = std::max(2u, std::thread::hardware_concurrency());
+	std::size_t queryCount = 1000u;
+	std::size_t rounds = 10u;
+	std::string mapPath = "200x200";
+
+	for(int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if(arg == "--threads" && i + 1 < argc)
+		{
+			threadCount = std::max(1, std::atoi(argv[++i]));
+		}
+		else if(arg == "--queries" && i + 1 < argc)
+		{
+			queryCount = std::max(1, std::atoi(argv[++i]));
+		}
+		else if(arg == "--rounds" && i + 1 < argc)
+		{
+			rounds = std::max(1, std::atoi(argv[++i]));
+		}
+		else
+		{
+			mapPath = arg;
+		}
+	}
+
+	const auto source = tmx::MapGenerator::parseSource(mapPath);
+	tmx::MapLoader ml(source.directory);
+
+	tmx::MapGenerator::Settings settings;
+	settings.layerCount = 1u;
+	settings.objectCount = source.mapSize.x * source.mapSize.y / 20u;
+	if(!tmx::MapGenerator::load(ml, source, settings))
+	{
+		std::cerr << "failed to load " << mapPath << std::endl;
+		return 1;
+	}
+
+	//queries of mixed sizes, some reaching off the map
+	const sf::FloatRect mapArea(sf::Vector2f(), sf::Vector2f(ml.getMapSize()));
+	std::minstd_rand rng(1234u);
+	std::uniform_real_distribution<float> x(mapArea.left - 64.f, mapArea.left + mapArea.width);
+	std::uniform_real_distribution<float> y(mapArea.top - 64.f, mapArea.top + mapArea.height);
+	std::uniform_real_distribution<float> size(8.f, 512.f);
+	std::vector<sf::FloatRect> areas(queryCount);
+	for(auto& area : areas)
+		area = sf::FloatRect(x(rng), y(rng), size(rng), size(rng));
+
+	std::cout << mapPath << ": " << queryCount << " queries, " << rounds << " rounds on "
+		<< threadCount << " threads" << std::endl;
+
+	bool passed = true;
+	std::cout << " quad tree" << std::endl;
+	ml.setSpatialIndex(tmx::SpatialIndex::QuadTree);
+	ml.updateQuadTree(mapArea);
+	passed &= runIndex(ml, areas, threadCount, rounds);
+
+	std::cout << " grid" << std::endl;
+	ml.setSpatialIndex(tmx::SpatialIndex::Grid);
+	ml.updateQuadTree(mapArea);
+	passed &= runIndex(ml, areas, threadCount, rounds);
+
+	return (passed) ? 0 : 1;
+}
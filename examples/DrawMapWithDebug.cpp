@@ -41,6 +41,11 @@ int main()
 	tmx::MapLoader ml("maps\\");
 	ml.load("desert.tmx");
 
+	//render stats are displayed with the debug output if a font is available
+	sf::Font font;
+	if(font.loadFromFile("fonts/Ubuntu-M.ttf"))
+		ml.setDebugFont(font);
+
 	//update the quad tree once so we can see it whe drawing debug
 	ml.updateQuadTree(sf::FloatRect(0.f, 0.f, 800.f, 600.f));
 
@@ -85,6 +90,7 @@ int main()
 			}
 		}
 		ml.updateQuadTree(sf::FloatRect(0.f, 0.f, 800.f, 600.f));
+		ml.update(frameClock.getElapsedTime()); //advances any animated tiles
 
 		//draw
 		frameClock.restart();
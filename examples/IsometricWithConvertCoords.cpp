@@ -40,8 +40,16 @@ int main()
 
 	//create map loader and load map
 	tmx::MapLoader ml("maps/");
+	ml.setDepthSorting(true); //allows drawing the marker between rows of tiles
 	ml.load("isometric_grass_and_water.tmx");
 
+	//marker which follows the mouse, sorted by the position of its base
+	sf::CircleShape marker(8.f);
+	marker.setOrigin(8.f, 16.f);
+	marker.setFillColor(sf::Color::Red);
+	tmx::DepthSorter sorter;
+	const auto markerId = sorter.add(marker, 0.f);
+
 	//adjust the view to centre on map
 	sf::View view = renderWindow.getView();
 	view.setCenter(0.f, 300.f);
@@ -64,14 +72,20 @@ int main()
 				debug = !debug;
         }
 
-		//draw map
+		//print mouse coords to orthographic (screen) coords and world (isometric) coords
+		sf::Vector2f mousePosScreen = renderWindow.mapPixelToCoords(sf::Mouse::getPosition(renderWindow));
+		marker.setPosition(mousePosScreen);
+		sorter.setDepth(markerId, mousePosScreen.y);
+
+		//draw map, with the marker sorted into the top layer
 		renderWindow.clear();
-		renderWindow.draw(ml);
+		const auto layerCount = ml.getLayers().size();
+		for(auto i = 0u; i + 1u < layerCount; ++i)
+			ml.drawLayer(renderWindow, i);
+		if(layerCount > 0u) ml.drawLayer(renderWindow, layerCount - 1u, sorter);
 		if(debug)ml.drawLayer(renderWindow, tmx::MapLayer::Debug);
 		renderWindow.display();
 
-		//print mouse coords to orthographic (screen) coords and world (isometric) coords
-		sf::Vector2f mousePosScreen = renderWindow.mapPixelToCoords(sf::Mouse::getPosition(renderWindow));
 		sf::Vector2f mousePosWorld = ml.orthogonalToIsometric(mousePosScreen);
 
 		std::stringstream stream;
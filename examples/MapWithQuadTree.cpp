@@ -44,6 +44,9 @@ int main()
 
 	//-----------------------------------//
 
+	//reused for each query so that querying doesn't allocate every frame
+	std::vector<tmx::MapObject*> objects;
+
 	while(renderWindow.isOpen())
 	{
 		//poll input
@@ -59,7 +62,7 @@ int main()
 		//get a vector of MapObjects contained in the quads intersected by query area
 		sf::Vector2f mousePos = renderWindow.mapPixelToCoords(sf::Mouse::getPosition(renderWindow));
 		//NOTE quad tree MUST be updated before attempting to query it
-		std::vector<tmx::MapObject*> objects = ml.queryQuadTree(sf::FloatRect(mousePos.x - 10.f, mousePos.y - 10.f, 20.f, 20.f));
+		ml.queryQuadTree(sf::FloatRect(mousePos.x - 10.f, mousePos.y - 10.f, 20.f, 20.f), objects);
 
 		//do stuff with returned objects
 		std::stringstream stream;
@@ -0,0 +1,338 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+The zlib license has been used to make this software fully compatible
+with SFML. See http://www.sfml-dev.org/license.php
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+
+//Headless spatial index benchmark. Loads each map, builds a quad tree and then a grid
+//over the whole map, and runs the same set of random queries through each of the query
+//functions, printing the time and number of heap allocations per query. The time taken
+//to rebuild the index is printed per rebuild, and the time to update the index after
+//moving one object in a hundred is printed per frame. Batched queries are run on one
+//thread and then on every hardware thread, a ray is cast across each query area, and the
+//nearest objects to the centre of each area, and those within half its width, are found.
+//
+//usage: QuadTreeBenchmark [--queries n] [--query-size pixels] [--auto-tune] [--synthetic WxH] [maps/map.tmx ...]
+//
+//synthetic maps of the given size in tiles are generated in memory with tmx::MapGenerator
+
+#include <SFML/System.hpp>
+#include <tmx/MapLoader.hpp>
+#include <tmx/MapGenerator.hpp>
+#include <tmx/Log.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <thread>
+
+namespace
+{
+	//counts every allocation made through the global operator new, from any thread
+	std::atomic<std::size_t> allocationCount(0u);
+
+	void* allocate(std::size_t size)
+	{
+		++allocationCount;
+		if(void* ptr = std::malloc(size ? size : 1u)) return ptr;
+		throw std::bad_alloc();
+	}
+}
+
+//every form of new and delete is replaced together, so that memory from malloc() is
+//only ever released by free()
+void* operator new(std::size_t size)
+{
+	return allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return allocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+#endif
+
+namespace
+{
+	struct Result
+	{
+		sf::Time time;
+		std::size_t allocations;
+		std::size_t objectsFound; //summed over all queries, to check each method agrees
+	};
+
+	template <typename T>
+	Result run(const std::vector<sf::FloatRect>& queries, T query)
+	{
+		Result result;
+		result.objectsFound = 0u;
+		const std::size_t startCount = allocationCount;
+		sf::Clock clock;
+		for(const auto& area : queries)
+			result.objectsFound += query(area);
+		result.time = clock.getElapsedTime();
+		result.allocations = allocationCount - startCount;
+		return result;
+	}
+
+	void print(const std::string& name, const Result& result, std::size_t queryCount)
+	{
+		std::cout << "  " << std::left << std::setw(10) << name << std::right
+			<< std::setw(10) << std::fixed << std::setprecision(3)
+			<< static_cast<double>(result.time.asMicroseconds()) / queryCount << " us/query"
+			<< std::setw(10) << std::setprecision(2)
+			<< static_cast<double>(result.allocations) / queryCount << " allocs/query"
+			<< std::setw(12) << result.objectsFound << " objects" << std::endl;
+	}
+
+	void printStats(const tmx::QuadTreeRoot::Stats& stats)
+	{
+		std::cout << "  " << stats.nodeCount << " nodes, " << stats.leafCount << " leaves, "
+			<< stats.maxObjectsPerLeaf << " max / " << std::setprecision(2) << stats.averageObjectsPerLeaf
+			<< " average objects per leaf, objects per level:";
+		for(auto count : stats.depthHistogram)
+			std::cout << " " << count;
+		std::cout << std::endl;
+	}
+
+	//times each query function, rebuilding and updating with the map loader's current spatial index
+	void runIndex(tmx::MapLoader& ml, const sf::FloatRect& area, const std::vector<sf::FloatRect>& queries, const std::vector<tmx::MapObject*>& objects)
+	{
+		const std::size_t queryCount = queries.size();
+
+		//rebuilding reuses the storage of the previous build
+		const std::size_t rebuildCount = 100u;
+		const std::vector<sf::FloatRect> rebuilds(rebuildCount, area);
+		print("rebuild", run(rebuilds, [&ml](const sf::FloatRect& area)
+		{
+			ml.updateQuadTree(area);
+			return 0u;
+		}), rebuildCount);
+
+		print("value", run(queries, [&ml](const sf::FloatRect& area)
+		{
+			return ml.queryQuadTree(area).size();
+		}), queryCount);
+
+		std::vector<tmx::MapObject*> results;
+		print("buffer", run(queries, [&ml, &results](const sf::FloatRect& area)
+		{
+			ml.queryQuadTree(area, results);
+			return results.size();
+		}), queryCount);
+
+		print("exact", run(queries, [&ml, &results](const sf::FloatRect& area)
+		{
+			ml.queryQuadTree(area, results, tmx::SpatialQuery::Overlapping);
+			return results.size();
+		}), queryCount);
+
+		print("visitor", run(queries, [&ml](const sf::FloatRect& area)
+		{
+			std::size_t count = 0u;
+			ml.visitQuadTree(area, [&count](tmx::MapObject*){ ++count; });
+			return count;
+		}), queryCount);
+
+		//the whole batch is run at once, after a first run to size the results
+		const std::vector<sf::FloatRect> batch(1u, area);
+		tmx::BatchQueryResults batchResults;
+		const sf::Uint32 threadCount = std::max(1u, std::thread::hardware_concurrency());
+		for(auto threads : { 1u, threadCount })
+		{
+			ml.queryQuadTree(queries.data(), queryCount, batchResults, tmx::SpatialQuery::Candidates, threads);
+			print("batch x" + std::to_string(threads), run(batch, [&ml, &queries, &batchResults, threads](const sf::FloatRect&)
+			{
+				ml.queryQuadTree(queries.data(), queries.size(), batchResults, tmx::SpatialQuery::Candidates, threads);
+				return batchResults.objects.size();
+			}), queryCount);
+		}
+
+		//rays across each query area, corner to corner
+		tmx::RaycastHit hit;
+		print("raycast", run(queries, [&ml, &hit](const sf::FloatRect& area)
+		{
+			return ml.raycast(sf::Vector2f(area.left, area.top), sf::Vector2f(area.left + area.width, area.top + area.height), hit) ? 1u : 0u;
+		}), queryCount);
+
+		//searches around the centre of each query area
+		print("nearest 8", run(queries, [&ml, &results](const sf::FloatRect& area)
+		{
+			ml.nearest(sf::Vector2f(area.left + area.width / 2.f, area.top + area.height / 2.f), 8u, results);
+			return results.size();
+		}), queryCount);
+
+		print("radius", run(queries, [&ml, &results](const sf::FloatRect& area)
+		{
+			ml.withinRadius(sf::Vector2f(area.left + area.width / 2.f, area.top + area.height / 2.f), area.width / 2.f, results);
+			return results.size();
+		}), queryCount);
+
+		print("objects at", run(queries, [&ml, &results](const sf::FloatRect& area)
+		{
+			ml.objectsAt(sf::Vector2f(area.left + area.width / 2.f, area.top + area.height / 2.f), results);
+			return results.size();
+		}), queryCount);
+
+		//move one object in a hundred each frame, and update only those in the index
+		const std::size_t frameCount = 100u;
+		std::vector<sf::FloatRect> frames(frameCount);
+		std::size_t frame = 0u;
+		print("move 1%", run(frames, [&ml, &objects, &frame](const sf::FloatRect&)
+		{
+			//back and forth so objects stay on the map
+			const float distance = (frame++ % 2u == 0u) ? 48.f : -48.f;
+			for(auto object : objects)
+			{
+				object->move(distance, distance);
+				ml.updateQuadTree(*object);
+			}
+			return objects.size();
+		}), frameCount);
+	}
+
+	bool runMap(const std::string& mapPath, std::size_t queryCount, float querySize, bool autoTune)
+	{
+		//synthetic maps are named by their size, eg 1000x1000
+		const auto source = tmx::MapGenerator::parseSource(mapPath);
+		tmx::MapLoader ml(source.directory);
+
+		tmx::MapGenerator::Settings settings;
+		settings.layerCount = 1u;
+		settings.objectCount = source.mapSize.x * source.mapSize.y / 20u;
+		if(!tmx::MapGenerator::load(ml, source, settings))
+		{
+			std::cerr << "failed to load " << mapPath << std::endl;
+			return false;
+		}
+
+		const sf::FloatRect area(sf::Vector2f(), sf::Vector2f(ml.getMapSize()));
+		ml.setQuadTreeAutoTune(autoTune);
+
+		//the same queries for every method
+		std::minstd_rand rng(1234u);
+		std::uniform_real_distribution<float> x(area.left, area.left + area.width - querySize);
+		std::uniform_real_distribution<float> y(area.top, area.top + area.height - querySize);
+		std::vector<sf::FloatRect> queries(queryCount);
+		for(auto& q : queries)
+			q = sf::FloatRect(x(rng), y(rng), querySize, querySize);
+
+		//and the same objects moved
+		std::vector<tmx::MapObject*> objects;
+		for(auto& layer : ml.getLayers())
+			for(auto& object : layer.objects)
+				objects.push_back(&object);
+		std::cout << mapPath << ": " << objects.size() << " objects, " << queryCount << " queries of " << querySize << "px" << std::endl;
+
+		std::shuffle(objects.begin(), objects.end(), rng);
+		objects.resize(std::max(std::size_t(1u), objects.size() / 100u));
+
+		std::cout << " quad tree" << std::endl;
+		ml.setSpatialIndex(tmx::SpatialIndex::QuadTree);
+		ml.updateQuadTree(area);
+		printStats(ml.getQuadTreeStats());
+		runIndex(ml, area, queries, objects);
+
+		std::cout << " grid" << std::endl;
+		ml.setSpatialIndex(tmx::SpatialIndex::Grid);
+		ml.updateQuadTree(area);
+		runIndex(ml, area, queries, objects);
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	tmx::setLogLevel(tmx::Logger::Error);
+
+	std::size_t queryCount = 10000u;
+	float querySize = 64.f;
+	bool autoTune = false;
+	std::vector<std::string> maps;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if(arg == "--queries" && i + 1 < argc)
+		{
+			queryCount = std::max(1, std::atoi(argv[++i]));
+		}
+		else if(arg == "--query-size" && i + 1 < argc)
+		{
+			querySize = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if(arg == "--auto-tune")
+		{
+			autoTune = true;
+		}
+		else if(arg == "--synthetic" && i + 1 < argc)
+		{
+			maps.push_back(argv[++i]);
+		}
+		else
+		{
+			maps.push_back(arg);
+		}
+	}
+
+	if(maps.empty())
+	{
+		maps = { "maps/desert.tmx", "maps/addRemove.tmx", "200x200" };
+	}
+
+	bool failed = false;
+	for(const auto& map : maps)
+		failed |= !runMap(map, queryCount, querySize, autoTune);
+
+	return (failed) ? 1 : 0;
+}
@@ -0,0 +1,270 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+The zlib license has been used to make this software fully compatible
+with SFML. See http://www.sfml-dev.org/license.php
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+
+//Headless rendering benchmark. Draws each map to an off screen render texture
+//while replaying scripted camera paths, and writes the render stats of every
+//frame as JSON so that runs can be compared between builds.
+//
+//usage: RenderBenchmark [--frames n] [--size WxH] [--lod levels] [--output file.json]
+//                       [--synthetic WxH] [maps/map.tmx ...]
+//
+//synthetic maps of the given size in tiles are generated in memory with tmx::MapGenerator
+
+#include <SFML/System.hpp>
+#include <SFML/Graphics.hpp>
+#include <tmx/MapLoader.hpp>
+#include <tmx/MapGenerator.hpp>
+#include <tmx/Log.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace
+{
+	struct CameraPath
+	{
+		std::string name;
+		//positions the view for the given frame. area is the world area covered by the map
+		std::function<void(sf::View&, const sf::FloatRect& area, unsigned frame, unsigned frameCount)> update;
+	};
+
+	std::vector<CameraPath> createPaths(const sf::Vector2f& viewSize)
+	{
+		std::vector<CameraPath> paths;
+
+		//diagonal sweep from top left to bottom right
+		paths.push_back({ "pan", [viewSize](sf::View& view, const sf::FloatRect& area, unsigned frame, unsigned frameCount)
+		{
+			const float t = static_cast<float>(frame) / static_cast<float>(frameCount);
+			view.setSize(viewSize);
+			view.setCenter(area.left + area.width * t, area.top + area.height * t);
+		} });
+
+		//zoom out from the centre until the whole map is visible, then back in
+		paths.push_back({ "zoom", [viewSize](sf::View& view, const sf::FloatRect& area, unsigned frame, unsigned frameCount)
+		{
+			const float maxZoom = std::max(1.f, std::max(area.width / viewSize.x, area.height / viewSize.y));
+			const float t = static_cast<float>(frame) / static_cast<float>(frameCount);
+			const float zoom = 1.f + (maxZoom - 1.f) * (1.f - std::abs(t * 2.f - 1.f));
+			view.setSize(viewSize * zoom);
+			view.setCenter(area.left + area.width / 2.f, area.top + area.height / 2.f);
+		} });
+
+		//jump to a different random position every frame, so nothing can be reused between frames
+		auto rng = std::make_shared<std::minstd_rand>();
+		paths.push_back({ "teleport", [viewSize, rng](sf::View& view, const sf::FloatRect& area, unsigned frame, unsigned)
+		{
+			if(frame == 0) rng->seed(1234u); //same sequence for every map and run
+			std::uniform_real_distribution<float> x(area.left, area.left + area.width);
+			std::uniform_real_distribution<float> y(area.top, area.top + area.height);
+			view.setSize(viewSize);
+			view.setCenter(x(*rng), y(*rng));
+		} });
+
+		return paths;
+	}
+
+	//the area of world space covered by the map's tiles
+	sf::FloatRect getWorldArea(const tmx::MapLoader& ml)
+	{
+		const sf::Vector2f mapSize(ml.getMapSize());
+		if(ml.getOrientation() == tmx::MapOrientation::Isometric)
+		{
+			//isometric maps are drawn as a diamond with the first tile at the top centre
+			const sf::Vector2f tileSize(ml.getTileSize());
+			const sf::Vector2f tileCount(mapSize.x / tileSize.x, mapSize.y / tileSize.y);
+			return sf::FloatRect(-tileCount.y * tileSize.x / 2.f, 0.f,
+				(tileCount.x + tileCount.y) * tileSize.x / 2.f, (tileCount.x + tileCount.y) * tileSize.y / 2.f);
+		}
+		return sf::FloatRect(sf::Vector2f(), mapSize);
+	}
+
+	//escapes characters which are not valid inside a JSON string, such as windows path separators
+	std::string jsonString(const std::string& str)
+	{
+		std::string result = "\"";
+		for(auto c : str)
+		{
+			if(c == '"' || c == '\\') result += '\\';
+			result += c;
+		}
+		return result + "\"";
+	}
+
+	void writeFrame(std::ostream& out, unsigned frame, const tmx::RenderStats& stats, sf::Time frameTime)
+	{
+		out << "        {\"frame\": " << frame
+			<< ", \"cullUs\": " << stats.cullTime.asMicroseconds()
+			<< ", \"drawUs\": " << stats.drawTime.asMicroseconds()
+			<< ", \"frameUs\": " << frameTime.asMicroseconds()
+			<< ", \"drawCalls\": " << stats.total.drawCalls
+			<< ", \"vertices\": " << stats.total.vertices
+			<< ", \"visiblePatches\": " << stats.total.visiblePatches
+			<< ", \"culledPatches\": " << stats.total.culledPatches
+			<< ", \"lodChunks\": " << stats.total.lodChunks
+			<< ", \"dirtyQuads\": " << stats.total.dirtyQuads
+			<< ", \"animatedQuads\": " << stats.total.animatedQuads << "}";
+	}
+
+	bool runMap(const std::string& mapPath, sf::RenderTexture& target, unsigned frameCount, sf::Uint8 lodLevels, std::ostream& out)
+	{
+		//synthetic maps are named by their size, eg 1000x1000
+		const auto source = tmx::MapGenerator::parseSource(mapPath);
+		tmx::MapLoader ml(source.directory);
+		ml.setLevelOfDetail(lodLevels);
+
+		tmx::MapGenerator::Settings settings;
+		settings.layerCount = 3u;
+		settings.sparsity = 0.3f;
+		settings.objectCount = source.mapSize.x * source.mapSize.y / 100u;
+
+		sf::Time loadTime;
+		if(!tmx::MapGenerator::load(ml, source, settings, &loadTime))
+		{
+			std::cerr << "failed to load " << mapPath << std::endl;
+			return false;
+		}
+
+		const sf::FloatRect area = getWorldArea(ml);
+		const auto paths = createPaths(sf::Vector2f(target.getSize()));
+
+		out << "  {\"map\": " << jsonString(mapPath) << ", \"loadUs\": " << loadTime.asMicroseconds() << ", \"paths\": [\n";
+		for(auto p = 0u; p < paths.size(); ++p)
+		{
+			out << "    {\"name\": " << jsonString(paths[p].name) << ", \"frames\": [\n";
+
+			sf::View view = target.getDefaultView();
+			sf::Clock frameClock;
+			for(auto frame = 0u; frame < frameCount; ++frame)
+			{
+				paths[p].update(view, area, frame, frameCount);
+				target.setView(view);
+
+				frameClock.restart();
+				ml.update(sf::seconds(1.f / 60.f));
+				target.clear();
+				target.draw(ml);
+				target.display();
+				const sf::Time frameTime = frameClock.getElapsedTime();
+
+				writeFrame(out, frame, ml.getRenderStats(), frameTime);
+				out << ((frame + 1 < frameCount) ? ",\n" : "\n");
+			}
+			out << "    ]}" << ((p + 1 < paths.size()) ? ",\n" : "\n");
+		}
+		out << "  ]}";
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	tmx::setLogLevel(tmx::Logger::Error);
+
+	unsigned frameCount = 300u;
+	sf::Vector2u size(800u, 600u);
+	sf::Uint8 lodLevels = 0u;
+	std::string outputPath;
+	std::vector<std::string> maps;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if(arg == "--frames" && i + 1 < argc)
+		{
+			frameCount = std::max(1, std::atoi(argv[++i]));
+		}
+		else if(arg == "--size" && i + 1 < argc)
+		{
+			char x;
+			std::stringstream ss(argv[++i]);
+			ss >> size.x >> x >> size.y;
+		}
+		else if(arg == "--lod" && i + 1 < argc)
+		{
+			lodLevels = static_cast<sf::Uint8>(std::atoi(argv[++i]));
+		}
+		else if(arg == "--synthetic" && i + 1 < argc)
+		{
+			maps.push_back(argv[++i]);
+		}
+		else if(arg == "--output" && i + 1 < argc)
+		{
+			outputPath = argv[++i];
+		}
+		else
+		{
+			maps.push_back(arg);
+		}
+	}
+
+	if(maps.empty())
+	{
+		maps = { "maps/desert.tmx", "maps/isometric_grass_and_water.tmx", "maps/shader_example.tmx" };
+	}
+
+	//render textures only need a GL context, so this runs without a window (eg under Mesa)
+	sf::RenderTexture target;
+	if(!target.create(size.x, size.y))
+	{
+		std::cerr << "failed to create render texture" << std::endl;
+		return 1;
+	}
+
+	std::ofstream file;
+	if(!outputPath.empty())
+	{
+		file.open(outputPath);
+		if(!file.good())
+		{
+			std::cerr << "failed to open " << outputPath << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& out = (file.is_open()) ? file : std::cout;
+
+	out << "{\"width\": " << size.x << ", \"height\": " << size.y
+		<< ", \"frames\": " << frameCount << ", \"lod\": " << static_cast<int>(lodLevels) << ", \"maps\": [\n";
+
+	bool success = true;
+	for(auto i = 0u; i < maps.size(); ++i)
+	{
+		if(i > 0) out << ",\n";
+		success = runMap(maps[i], target, frameCount, lodLevels, out) && success;
+	}
+	out << "\n]}" << std::endl;
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+Zlib License:
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+#ifndef DEPTH_SORTER_HPP_
+#define DEPTH_SORTER_HPP_
+
+#include <tmx/Export.hpp>
+
+#include <SFML/Graphics/Drawable.hpp>
+
+#include <vector>
+
+namespace tmx
+{
+	/*!
+    \brief Keeps a list of drawables ordered by depth, so that they can be drawn
+	between the tile rows of a layer with MapLoader::drawLayer(). Depth is usually
+	the y coordinate of the base of a sprite, as returned by MapTile::getBase().
+	Changing the depth of a drawable moves it only as far as needed to restore the
+	order, so entities which move a little each frame are cheap to keep sorted.
+	Drawables are referenced, not copied, and must outlive the sorter or be removed.
+    */
+	class TMX_EXPORT_API DepthSorter final
+	{
+	public:
+		using Id = sf::Uint32;
+		struct Entry final
+		{
+			float depth;
+			Id id;
+			const sf::Drawable* drawable;
+		};
+
+		/*!
+        \brief Adds a drawable at the given depth, and returns the ID used to update or remove it
+        */
+		Id add(const sf::Drawable& drawable, float depth);
+		/*!
+        \brief Updates the depth of a drawable
+        */
+		void setDepth(Id id, float depth);
+		/*!
+        \brief Removes a drawable. Its ID may be reused
+        */
+		void remove(Id id);
+		/*!
+        \brief Removes all drawables
+        */
+		void clear();
+		/*!
+        \brief Returns the drawables in order of increasing depth
+        */
+		const std::vector<Entry>& getEntries() const { return m_entries; }
+
+	private:
+		std::vector<Entry> m_entries;
+		std::vector<sf::Uint32> m_positions; //index of each ID in m_entries
+		std::vector<Id> m_freeIds;
+
+		//swaps an entry with its neighbours until the order is restored
+		void restoreOrder(sf::Uint32 position);
+	};
+}
+
+#endif //DEPTH_SORTER_HPP_
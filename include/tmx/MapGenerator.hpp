@@ -0,0 +1,124 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+Zlib License:
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+#ifndef MAP_GENERATOR_HPP_
+#define MAP_GENERATOR_HPP_
+
+#include <tmx/MapObject.hpp>
+#include <tmx/Export.hpp>
+
+#include <SFML/System/Time.hpp>
+
+#include <string>
+#include <map>
+
+namespace tmx
+{
+	class MapLoader;
+
+	/*!
+    \brief Writes synthetic tmx maps used for scale testing the loader, renderer and quad tree.
+    Maps are generated from a seed so the same settings always produce the same map. By default
+    the generated tile sets reference the tmw_desert_spacing.png image in the maps directory,
+    so maps should be saved to, or loaded from memory with a search path to, that directory.
+    */
+	class TMX_EXPORT_API MapGenerator final
+	{
+	public:
+		enum class Encoding
+		{
+			Xml,
+			Csv,
+			Base64,
+			Zlib,
+			Gzip
+		};
+
+		struct TMX_EXPORT_API Settings final
+		{
+			Settings();
+			sf::Vector2u mapSize; //in tiles
+			sf::Vector2u tileSize;
+			sf::Uint16 layerCount; //number of tile layers
+			Encoding encoding;
+			float sparsity; //range 0 - 1, chance of any tile being empty
+
+			sf::Uint16 tilesetCount; //tile sets all share the same image
+			std::string tilesetImage;
+			sf::Vector2u tilesetImageSize;
+			sf::Uint16 tilesetSpacing;
+			sf::Uint16 tilesetMargin;
+
+			sf::Uint16 objectLayerCount;
+			sf::Uint32 objectCount; //total, spread evenly over the object layers
+			std::map<MapObjectShape, float> shapeMix; //relative weight of each object shape
+			sf::Uint32 seed;
+		};
+
+		/*!
+        \brief Where to find a map named on the command line of a benchmark or example. A name
+        of the form WxH, for example 1000x1000, is a map of that size in tiles to generate,
+        anything else is the path of a tmx file
+        */
+		struct TMX_EXPORT_API Source final
+		{
+			Source() : generated(false){}
+			bool generated;
+			sf::Vector2u mapSize; //in tiles, if generated
+			std::string directory; //to construct the MapLoader with, the maps directory if generated
+			std::string file; //tmx file within the directory, if not generated
+		};
+
+		explicit MapGenerator(const Settings& settings = Settings());
+		/*!
+        \brief Returns the generated map as a tmx xml string, suitable for
+        MapLoader::loadFromMemory()
+        */
+		std::string toString() const;
+		/*!
+        \brief Writes the generated map to the given path. Returns false on failure
+        */
+		bool saveToFile(const std::string& path) const;
+		/*!
+        \brief Parses a map name given on the command line, see Source
+        */
+		static Source parseSource(const std::string& name);
+		/*!
+        \brief Loads the map described by source into loader, which should have been constructed
+        with the source's directory. Generated maps use the given settings, apart from their
+        size. If loadTime isn't null it is set to the time taken to load the map, not counting
+        the time taken to generate it. Returns false on failure
+        */
+		static bool load(MapLoader& loader, const Source& source, Settings settings, sf::Time* loadTime = nullptr);
+
+	private:
+		Settings m_settings;
+	};
+}
+
+#endif //MAP_GENERATOR_HPP_
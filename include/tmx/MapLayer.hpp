@@ -30,6 +30,8 @@ it freely, subject to the following restrictions:
 #define MAPLAYER_HPP_
 
 #include <tmx/MapObject.hpp>
+#include <tmx/RenderStats.hpp>
+#include <tmx/DepthSorter.hpp>
 #include <tmx/Export.hpp>
 
 #include <memory>
@@ -38,16 +40,28 @@ it freely, subject to the following restrictions:
 namespace tmx
 {
 	class LayerSet;
+
+	/*!
+    \brief The frame currently displayed by a tile animation, shared by all tiles using it
+    */
+	struct TileAnimationFrame final
+	{
+		TileAnimationFrame() : index(0u){}
+		std::array<sf::Vector2f, 4u> texCoords; //texture coordinates of the frame's tile, unflipped
+		sf::Uint32 index; //index of the frame within its animation
+	};
+
 	class TMX_EXPORT_API TileQuad final
 	{
 		friend class LayerSet;
 	public:
 		using Ptr = std::shared_ptr<TileQuad>; //TODO shared libs don't like this being a unique_ptr
-		TileQuad(sf::Uint16 i0, sf::Uint16 i1, sf::Uint16 i2, sf::Uint16 i3);
+		//index of the first of the four consecutive vertices in the parent patch
+		explicit TileQuad(sf::Uint32 firstIndex);
 		void move(const sf::Vector2f& distance);
         void setVisible(bool);
 	private:
-		std::array<sf::Uint16, 4u> m_indices;
+		sf::Uint32 m_firstIndex;
         sf::Color m_colour;
 		sf::Vector2f m_movement;
 		LayerSet* m_parentSet;
@@ -62,14 +76,81 @@ namespace tmx
 	{
 		friend class TileQuad;
 	public:	
-
+		/*!
+		\brief Constructor. Patch size is the number of tiles along each edge of a patch.
+		A patch size of 0 places the whole layer in a single vertex array, drawn with one
+		call. This suits small maps, or views which show most of the map at once.
+		*/
 		LayerSet(const sf::Texture& texture, sf::Uint8 patchSize, const sf::Vector2u& mapSize, const sf::Vector2u tileSize);
 		TileQuad* addTile(sf::Vertex vt0, sf::Vertex vt1, sf::Vertex vt2, sf::Vertex vt3, sf::Uint16 x, sf::Uint16 y);
-		void cull(const sf::FloatRect& bounds);
+		/*!
+		\brief Adds the four vertices of a tile which is never moved or hidden on its own,
+		so no TileQuad is created for it
+		*/
+		void addTile(const sf::Vertex* vertices, sf::Uint16 x, sf::Uint16 y);
+		/*!
+		\brief Culls patches outside the given bounds. Tile bounds is the area of the map grid,
+		in tiles, which may appear inside the world bounds for the map's orientation. Only
+		patches in that area whose vertices intersect the world bounds are drawn. Scale is
+		the number of screen pixels per world unit, and is used to select the level of detail
+		if one has been built
+		*/
+		void cull(const sf::FloatRect& bounds, const sf::IntRect& tileBounds, float scale = 1.f);
+		/*!
+		\brief Applies the changes made to tile quads since the last update. The bounds of a
+		patch grow to cover its quads when they are moved, but never shrink. Returns true if
+		any bounds grew, in which case the set should be culled again before it is drawn.
+		This is also done when the set is drawn.
+		*/
+		bool updateQuads() const;
+		/*!
+		\brief Builds a pyramid of downsampled chunk textures used when the view is zoomed out.
+		Each level halves the resolution of the previous one and covers twice as many patches
+		along each edge, so the number of quads drawn stays bounded however far out the view
+		is zoomed. Levels are used while they still provide at least minTexelDensity texels
+		per screen pixel. Moving or hiding tiles is not reflected in the downsampled levels.
+		*/
+		void buildLod(sf::Uint8 levels, float minTexelDensity);
+		/*!
+		\brief The most levels of detail which may be built. Each level doubles the size of a
+		chunk, so further levels would cover more than any map and overflow the chunk size
+		*/
+		static const sf::Uint8 maxLodLevels = 16u;
+		/*!
+		\brief Returns the counters gathered the last time this set was drawn
+		*/
+		const RenderStats::Counters& getStats() const { return m_stats; }
+		/*!
+		\brief Marks the most recently added tile as animated. Frames is the list of current
+		frames for every animation, and must outlive this set. Corners maps each vertex of the
+		tile to a corner of the frame's texture coordinates so that flipped tiles stay flipped.
+		Animated tiles are only updated when their patch is drawn.
+		*/
+		void animateLastTile(const std::vector<TileAnimationFrame>& frames, sf::Uint32 animation, const std::array<sf::Uint8, 4u>& corners);
+		/*!
+		\brief Sorts the tiles in each patch by the bottom edge of their quads and groups them
+		into bands of the given height, so that patches can be drawn a band at a time with
+		drawBand(). Quads moved after this is called stay in their original band.
+		*/
+		void buildDepthBands(float bandHeight);
+		/*!
+		\brief Returns the height of the depth bands, or 0 if they haven't been built
+		*/
+		float getBandHeight() const { return m_bandHeight; }
+		/*!
+		\brief Prepares the set for drawing with drawBand() and finds the range of bands
+		visible since the last cull. Returns false if the set has no depth bands, nothing is
+		visible, or a level of detail is in use, in which case the set should be drawn whole
+		*/
+		bool getVisibleBands(sf::Int32& first, sf::Int32& last) const;
+		/*!
+		\brief Draws the tiles of the given band in each visible patch
+		*/
+		void drawBand(sf::RenderTarget& rt, sf::RenderStates states, sf::Int32 band) const;
 
 	private:
 		const sf::Texture& m_texture;
-		const sf::Uint8 m_patchSize;
+		const sf::Vector2u m_patchTiles; //number of tiles along each edge of a patch
 		const sf::Vector2u m_mapSize;
 		const sf::Vector2u m_patchCount;
 		const sf::Vector2u m_tileSize;
@@ -77,14 +158,63 @@ namespace tmx
 		std::vector<TileQuad::Ptr> m_quads;
 		mutable std::vector<TileQuad*> m_dirtyQuads;
 
-		sf::Vector2i m_visiblePatchStart, m_visiblePatchEnd;
+		std::vector<sf::Uint32> m_visiblePatches; //indices of patches to draw, in row order
 		mutable std::vector<std::vector<sf::Vertex>> m_patches;
+		mutable std::vector<sf::FloatRect> m_patchBounds; //world space bounds of each patch's vertices
+		mutable std::vector<sf::Uint32> m_grownPatches; //sorted indices of patches grown by moved quads
+		mutable sf::Uint32 m_updatedQuads; //quads updated since the set was last drawn
+		sf::Uint32 m_filledPatchCount; //patches containing at least one tile
+		sf::Int32 m_lastPatchIndex; //patch the most recent tile was added to
+		//appends a quad to the patch at the given tile position, and returns the patch index
+		sf::Int32 addVertices(const sf::Vertex* vertices, sf::Uint16 x, sf::Uint16 y);
+		mutable RenderStats::Counters m_stats;
 
 		void draw(sf::RenderTarget& rt, sf::RenderStates states) const override;
 
+		struct AnimatedTile final
+		{
+			sf::Uint32 firstIndex; //first vertex of the quad in its patch
+			sf::Uint32 animation;
+			sf::Uint32 frame; //frame index last written to the patch
+			std::array<sf::Uint8, 4u> corners;
+		};
+		const std::vector<TileAnimationFrame>* m_animationFrames;
+		mutable std::vector<std::vector<AnimatedTile>> m_animatedTiles; //indexed by patch
+		void updateAnimatedTiles(sf::Uint32 patchIndex) const;
+
+		struct PatchBands final
+		{
+			PatchBands() : first(0){}
+			sf::Int32 first; //band of the first quad in the patch
+			std::vector<sf::Uint32> starts; //index of the first vertex of each band, plus the end of the patch
+		};
+		std::vector<PatchBands> m_patchBands;
+		float m_bandHeight;
+
+		//updates dirty and animated quads, and resets the stats, before drawing. Culling
+		//isn't repeated, so moved quads may not be drawn until the set is culled again
+		void prepareDraw() const;
+
 		mutable sf::FloatRect m_boundingBox;
 		void updateAABB(sf::Vector2f position, sf::Vector2f size);
 		bool m_visible;
+
+		struct LodChunk final
+		{
+			std::shared_ptr<sf::Texture> texture; //null if chunk contains no tiles
+			std::array<sf::Vertex, 4u> vertices;
+		};
+		struct LodLevel final
+		{
+			sf::Vector2u chunkCount;
+			sf::Vector2f chunkSize; //size of a chunk in world units
+			std::vector<LodChunk> chunks;
+		};
+		std::vector<LodLevel> m_lodLevels;
+		sf::Vector2f m_lodOrigin;
+		float m_minTexelDensity;
+		sf::Uint8 m_currentLod; //0 is full detail, else index + 1 into m_lodLevels
+		sf::Vector2i m_visibleChunkStart, m_visibleChunkEnd;
 	};
 
 
@@ -123,19 +253,64 @@ namespace tmx
 		MapObjects objects; //vector of objects if layer is object group
 		MapLayerType type;
 		std::map <std::string, std::string> properties;
+		sf::Vector2f offset; //from the tmx offsetx and offsety attributes, in pixels
+		sf::Vector2f parallaxFactor; //1 scrolls with the map, 0 stays fixed to the view
 
 		std::map<sf::Uint16, std::shared_ptr<LayerSet>> layerSets;
+
+		/*!
+        \brief Describes the patch size used by a tile layer and its expected cost
+        when drawn with a view of the size given to MapLoader::setAutoPatchSize()
+        */
+		struct PatchInfo final
+		{
+			PatchInfo() : patchSize(0u), expectedDrawCalls(0.f), expectedVertices(0.f), expectedOverdraw(1.f){}
+			sf::Uint8 patchSize; //number of tiles along each edge of a patch, 0 for a single patch
+			//for the whole layer. A patch using several tilesets is counted once, although each
+			//tileset's layer set draws it with a call of its own, so this is a lower bound for such layers
+			float expectedDrawCalls;
+			float expectedVertices; //for the whole layer, across all of its layer sets
+			float expectedOverdraw; //ratio of the area of the patches drawn to the area of the view
+		};
+		PatchInfo patchInfo;
         /*!
         \brief Sets the shader which will be used when drawing this layer
         */
 		void setShader(const sf::Shader& shader);
         /*!
-        \brief Used to cull patches outside the visible area
+        \brief Updates the transform used to draw the layer from its offset and parallax
+        factor, for a view centred on the given point. The layer sits at its offset when
+        the view is centred on the parallax origin. Returns the layer's translation
+        */
+		sf::Vector2f updateTransform(const sf::Vector2f& viewCentre, const sf::Vector2f& parallaxOrigin);
+        /*!
+        \brief Returns the transform applied to the layer when it is drawn
+        */
+		const sf::Transform& getTransform() const { return m_transform; }
+        /*!
+        \brief Used to cull patches outside the visible area. Bounds are in the layer's
+        own space, before its transform is applied. Tile bounds is the part of the map
+        grid which may be visible, and scale is the number of screen pixels per world unit
         */
-		void cull(const sf::FloatRect& bounds);
+		void cull(const sf::FloatRect& bounds, const sf::IntRect& tileBounds, float scale = 1.f);
+		/*!
+		\brief Applies the changes made to tile quads in each of the layer's sets, and returns
+		true if the layer should be culled again. See LayerSet::updateQuads()
+		*/
+		bool updateQuads() const;
+		/*!
+		\brief Draws the layer a depth band at a time, drawing the given drawables after the
+		tiles of the band containing their depth. Layer sets without depth bands are drawn
+		before any bands. Drawables are positioned in world space, so are not affected by
+		the layer's transform. See MapLoader::setDepthSorting()
+		*/
+		void drawSorted(sf::RenderTarget& rt, const DepthSorter& drawables, sf::RenderStates states = sf::RenderStates::Default) const;
 
 	private:
 		const sf::Shader* m_shader;
+		sf::Vector2f m_translation;
+		sf::Transform m_transform;
+		mutable std::vector<const LayerSet*> m_bandedSets; //reused by drawSorted()
 		void draw(sf::RenderTarget& rt, sf::RenderStates states) const override;
 	};
 };
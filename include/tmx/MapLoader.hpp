@@ -30,6 +30,10 @@ it freely, subject to the following restrictions:
 #define MAP_LOADER_HPP_
 
 #include <tmx/QuadTreeNode.hpp>
+#include <tmx/SpatialGrid.hpp>
+#include <tmx/StaticRTree.hpp>
+#include <tmx/ObjectIndex.hpp>
+#include <tmx/WorkerPool.hpp>
 #include <tmx/MapLayer.hpp>
 
 #include <pugixml/pugixml.hpp>
@@ -37,6 +41,8 @@ it freely, subject to the following restrictions:
 #include <array>
 #include <cassert>
 #include <bitset>
+#include <functional>
+#include <unordered_set>
 
 namespace tmx
 {
@@ -44,7 +50,61 @@ namespace tmx
 	{
 		Orthogonal,
 		Isometric,
-		SteppedIsometric
+		SteppedIsometric, //'staggered' in Tiled
+		Hexagonal
+	};
+
+	/*!
+    \brief The structure used to partition map objects, see MapLoader::setSpatialIndex()
+    */
+	enum class SpatialIndex
+	{
+		QuadTree,
+		Grid
+	};
+
+	/*!
+    \brief Results of a batch of queries, see MapLoader::queryQuadTree(). The objects found
+    by query i are stored in objects from offsets[i] up to offsets[i + 1]
+    */
+	struct BatchQueryResults final
+	{
+		std::vector<sf::Uint32> offsets; //one more than the number of queries
+		std::vector<MapObject*> objects;
+
+		std::size_t size() const { return offsets.empty() ? 0u : offsets.size() - 1u; }
+		std::size_t count(std::size_t query) const { return offsets[query + 1u] - offsets[query]; }
+		MapObject* const* begin(std::size_t query) const { return objects.data() + offsets[query]; }
+		MapObject* const* end(std::size_t query) const { return objects.data() + offsets[query + 1u]; }
+
+	private:
+		friend class MapLoader;
+		struct Range final
+		{
+			sf::Uint32 thread, start, count;
+		};
+		//kept between batches to avoid reallocating
+		std::vector<std::pair<sf::Uint32, sf::Uint32>> m_order; //Morton code and index of each query, in the order run
+		std::vector<std::vector<MapObject*>> m_threadObjects; //objects found by each thread
+		std::vector<Range> m_ranges; //where each query's objects were stored
+	};
+
+	/*!
+    \brief Returns true for objects which should be included in the results of a search,
+    see MapLoader::nearest()
+    */
+	using ObjectFilter = std::function<bool(const MapObject&)>;
+
+	/*!
+    \brief The nearest object hit by a ray, see MapLoader::raycast()
+    */
+	struct RaycastHit final
+	{
+		RaycastHit() : object(nullptr), distance(0.f){}
+		MapObject* object;
+		sf::Vector2f point; //in world coords
+		float distance; //from the start of the ray to the point
+		sf::Vector2f normal; //unit normal of the edge hit, facing the start of the ray
 	};
 
     /*!
@@ -73,16 +133,169 @@ namespace tmx
         */
 		void addSearchPath(const std::string& path);
 		/*!
+        \brief Advances any tile animations by the given time. Only tiles in patches which
+        are drawn are updated, so the cost depends on the number of visible animated tiles
+        */
+		void update(sf::Time dt);
+		/*!
         \brief Updates the map's quad tree.
         Not necessary when not querying the quad tree. Root area is the area covered by root node,
-        for example the screen size
+        for example the screen size. Objects on layers marked static are left out, as they are
+        kept in the static tree instead, see getStaticTree(). Objects are indexed where they are
+        in the map, ignoring the offset and parallax applied to their layer when it is drawn, so
+        every query takes map coords. To find objects as drawn on such a layer, first transform
+        world coords by the inverse of the layer's MapLayer::getTransform()
         */
 		void updateQuadTree(const sf::FloatRect& rootArea);
 		/*!
+        \brief Selects whether updateQuadTree() builds a quad tree or a uniform grid. All
+        of the quad tree functions then use the selected structure. A grid is usually faster
+        when most objects are of a similar size and evenly spread. Cell size is the size of
+        each grid cell, or zero to use twice the map's tile size. Takes effect the next time
+        updateQuadTree() is called with a root area
+        */
+		void setSpatialIndex(SpatialIndex index, const sf::Vector2f& cellSize = sf::Vector2f());
+		/*!
+        \brief Moves a single object within the quad tree after it has been moved, rather than
+        rebuilding the whole tree. The cost depends only on the number of objects updated.
+        Objects on static layers must not be moved, and are ignored
+        */
+		void updateQuadTree(const MapObject& object);
+		/*!
         \brief Queries the quad tree and returns a vector of objects contained by nodes enclosing
-		or intersecting testArea
+		or intersecting testArea, followed by any objects found in the static tree. Test area is
+		in map coords, see updateQuadTree()
+        */
+		std::vector<MapObject*> queryQuadTree(const sf::FloatRect& testArea) const;
+		/*!
+        \brief Queries the quad tree, filling results with objects contained by nodes enclosing
+        or intersecting testArea. Results is cleared first, so reusing the same vector for each
+        query avoids allocating once it has grown large enough. Pass SpatialQuery::Overlapping
+        to return only the objects whose AABB overlaps testArea. If stats isn't null the work
+        done by the query is added to it. Queries never modify the map, so may be made from
+        several threads at once while no objects are being added, moved or updated
+        */
+		void queryQuadTree(const sf::FloatRect& testArea, std::vector<MapObject*>& results,
+			SpatialQuery query = SpatialQuery::Candidates, SpatialQueryStats* stats = nullptr) const;
+		/*!
+        \brief Runs a query for each of count areas, storing the objects found by all of them
+        in results. The queries are run in Morton order of the areas' centres, so that queries
+        close to each other visit the same nodes in turn, and may be spread over threadCount
+        threads, but results are stored in the order the areas are given. Reusing the same
+        results for each batch avoids allocating once it has grown large enough. The threads
+        are started by the first batch to need them and kept for later batches, see WorkerPool
+        */
+		void queryQuadTree(const sf::FloatRect* areas, std::size_t count, BatchQueryResults& results,
+			SpatialQuery query = SpatialQuery::Candidates, sf::Uint32 threadCount = 1u) const;
+		/*!
+        \brief Calls visitor, a function or function object taking a MapObject*, for each object
+        contained by nodes enclosing or intersecting testArea. Never allocates
+        */
+		template <typename T>
+		void visitQuadTree(const sf::FloatRect& testArea, T visitor, SpatialQuery query = SpatialQuery::Candidates,
+			SpatialQueryStats* stats = nullptr) const
+		{
+			if(m_spatialIndex == SpatialIndex::Grid)
+				m_grid.visit(testArea, visitor, query, stats);
+			else
+				m_rootNode.visit(testArea, visitor, query, stats);
+			m_staticTree.visit(testArea, visitor, query, stats);
+		}
+		/*!
+        \brief Finds the nearest object whose shape is crossed by the segment from start to end,
+        in map coords, which differ from world coords on offset or parallax layers. The spatial index is walked in the order the segment passes through it,
+        and stops once nothing nearer than the nearest hit can remain. Returns false if nothing
+        is hit. Requires updateQuadTree() to have been called
+        */
+		bool raycast(const sf::Vector2f& start, const sf::Vector2f& end, RaycastHit& hit) const;
+		/*!
+        \brief Returns true if the segment from start to end crosses no object's shape. Stops at
+        the first object hit, so is cheaper than raycast() when the hit itself isn't needed
+        */
+		bool lineOfSight(const sf::Vector2f& start, const sf::Vector2f& end) const;
+		/*!
+        \brief Tests line of sight between each of count pairs of points, setting the matching
+        element of results to 1 if the segment between them is clear, else 0. The tests may be
+        spread over threadCount threads, which are kept between calls as for batched queries
+        */
+		void lineOfSight(const sf::Vector2f* starts, const sf::Vector2f* ends, std::size_t count,
+			std::vector<sf::Uint8>& results, sf::Uint32 threadCount = 1u) const;
+		/*!
+        \brief Finds up to k objects nearest to the point, measured to the nearest point of each
+        object's shape, and stores them in results, nearest first. Objects for which filter
+        returns false are skipped. The spatial index is searched outwards from the point and
+        stops once the nearest k objects found so far are nearer than anything left to search.
+        The point is in map coords, see updateQuadTree(). Results is cleared first. Requires
+        updateQuadTree() to have been called
+        */
+		void nearest(const sf::Vector2f& point, std::size_t k, std::vector<MapObject*>& results,
+			const ObjectFilter& filter = ObjectFilter()) const;
+		std::vector<MapObject*> nearest(const sf::Vector2f& point, std::size_t k, const ObjectFilter& filter = ObjectFilter()) const;
+		/*!
+        \brief Finds every object whose shape lies within radius of the point, in no particular
+        order, and stores them in results. Objects for which filter returns false are skipped.
+        Results is cleared first. Requires updateQuadTree() to have been called
+        */
+		void withinRadius(const sf::Vector2f& point, float radius, std::vector<MapObject*>& results,
+			const ObjectFilter& filter = ObjectFilter()) const;
+		std::vector<MapObject*> withinRadius(const sf::Vector2f& point, float radius, const ObjectFilter& filter = ObjectFilter()) const;
+		/*!
+        \brief Finds every object on any object layer whose shape contains the point, in no
+        particular order, and stores them in results. The point is in map coords, so an object
+        on an offset layer is found where it would be without the offset, see updateQuadTree(). Only objects whose bounds contain the
+        point are tested against their shape, see MapObject::contains(). Objects for which
+        filter returns false are skipped. Results is cleared first. Requires updateQuadTree()
+        to have been called
         */
-		std::vector<MapObject*> queryQuadTree(const sf::FloatRect& testArea);
+		void objectsAt(const sf::Vector2f& point, std::vector<MapObject*>& results, const ObjectFilter& filter = ObjectFilter()) const;
+		std::vector<MapObject*> objectsAt(const sf::Vector2f& point, const ObjectFilter& filter = ObjectFilter()) const;
+		/*!
+        \brief Returns the tree built when the map is loaded from the objects of every object
+        layer with a property named static set to true. These objects should never move. The
+        tree is never modified after loading, so may be queried from several threads at once
+        */
+		const StaticRTree& getStaticTree() const { return m_staticTree; }
+		/*!
+        \brief Returns the objects on any object layer with the given name, in the order they
+        were loaded or added. Lookups take constant time, see getObjectIndex()
+        */
+		ObjectSpan getObjectsByName(const std::string& name) const { return m_objectIndex.findByName(name); }
+		/*!
+        \brief Returns the objects on any object layer with the given type
+        */
+		ObjectSpan getObjectsByType(const std::string& type) const { return m_objectIndex.findByType(type); }
+		/*!
+        \brief Returns the objects on any object layer with a property of the given name,
+        whatever its value
+        */
+		ObjectSpan getObjectsWithProperty(const std::string& name) const { return m_objectIndex.findWithProperty(name); }
+		/*!
+        \brief Returns the objects on any object layer with a property of the given name set to
+        the given value
+        */
+		ObjectSpan getObjectsByProperty(const std::string& name, const std::string& value) const { return m_objectIndex.findByProperty(name, value); }
+		/*!
+        \brief Returns the index of objects by name, type and property, built when the map is
+        loaded from every object layer. Objects stay in the index while they stay at the same
+        address, so objects must not be added directly to a layer's vector of objects once
+        the map is loaded. Spans returned by the index are invalidated by addObject() and
+        removeObject()
+        */
+		const ObjectIndex& getObjectIndex() const { return m_objectIndex; }
+		/*!
+        \brief Adds an object to the object index, and to the quad tree if it has been built,
+        and keeps it in the quad tree when it is rebuilt. The object is not owned by the map
+        and must stay at the same address until it is removed or the map is unloaded. Objects
+        which have already been added, or were loaded with the map, are indexed again, so
+        this should be called after an object's name, type or properties are changed
+        */
+		void addObject(MapObject& object);
+		/*!
+        \brief Removes an object added with addObject() or loaded with the map from the object
+        index and the quad tree. Returns false if the object wasn't found, or is on a static
+        layer, as the static tree can't be modified
+        */
+		bool removeObject(const MapObject& object);
 		/*!
         \brief Returns a vector of map layers
         */
@@ -100,6 +313,12 @@ namespace tmx
         */
 		void drawLayer(sf::RenderTarget& rt, sf::Uint16 index, bool debug = false);
 		/*!
+        \brief Draws a layer by index with the given drawables sorted between its rows of tiles.
+        Requires depth sorting to be enabled with setDepthSorting() before loading the map,
+        otherwise the drawables are drawn after the layer
+        */
+		void drawLayer(sf::RenderTarget& rt, sf::Uint16 index, const DepthSorter& drawables);
+		/*!
         \brief Projects orthogonal world coords to isometric world coords if available, else returns original value.
 		eg: use to convert an isometric world coordinate to a position to be drawn in view space
         */
@@ -118,6 +337,10 @@ namespace tmx
         */
 		sf::Vector2u getMapSize() const;
 		/*!
+        \brief Returns the orientation of the loaded map
+        */
+		MapOrientation getOrientation() const;
+		/*!
         \brief Returns empty string if property not found
         */
 		std::string getPropertyString(const std::string& name);
@@ -129,6 +352,59 @@ namespace tmx
         \brief Returns true if the Quad Tree is available
         */
         bool quadTreeAvailable() const;
+		/*!
+        \brief Sets the maximum objects per node and maximum depth of the quad tree. An
+        existing tree is rebuilt to match. Turns off auto tuning, as it would replace these
+        settings on the next rebuild, see setQuadTreeAutoTune()
+        */
+		void setQuadTreeSettings(const QuadTreeRoot::Settings& settings);
+		/*!
+        \brief Enables choosing the quad tree settings each time updateQuadTree() rebuilds
+        the tree, from the root area and the number and sizes of the map's objects.
+        See QuadTreeRoot::autoTune()
+        */
+		void setQuadTreeAutoTune(bool enabled);
+		/*!
+        \brief Returns the node count, objects per leaf and depth histogram of the quad tree.
+        Returns empty stats while a grid is the spatial index in use, see setSpatialIndex()
+        */
+		QuadTreeRoot::Stats getQuadTreeStats() const;
+		/*!
+        \brief Sets the number of downsampled levels of detail built for each tile layer.
+        Must be called before load(). When the view is zoomed out the coarsest level
+        which still provides minTexelDensity texels per screen pixel is drawn in place of
+        the individual tiles. 0 (the default) disables level of detail. Levels is clamped to
+        LayerSet::maxLodLevels, and no more levels are built than it takes for a single chunk
+        to cover the layer
+        */
+		void setLevelOfDetail(sf::Uint8 levels, float minTexelDensity = 1.f);
+		/*!
+        \brief Enables picking a patch size for each tile layer when a map is loaded, in place
+        of the patch size given to the constructor. The size is chosen from the tile size, the
+        expected size of the view and how sparse the layer is, to balance the number of draw
+        calls against the number of vertices drawn off screen. The chosen values are available
+        in MapLayer::patchInfo. Must be called before load().
+        */
+		void setAutoPatchSize(bool enabled, const sf::Vector2f& expectedViewSize = sf::Vector2f(1280.f, 720.f));
+		/*!
+        \brief Enables sorting the tiles of each patch into depth bands when a map is loaded, so
+        that drawables can be drawn between rows of tiles with drawLayer(). A band is one row of
+        tiles, or half a row on isometric maps and maps staggered along the x axis, measured at
+        the bottom of each tile. Must be called before load().
+        */
+		void setDepthSorting(bool enabled);
+		/*!
+        \brief Returns statistics gathered the last time the whole map was drawn,
+        either by drawing the MapLoader directly or with drawLayer() using MapLayer::All.
+        Drawing a single layer with drawLayer(), with or without depth sorting, updates
+        the counters of that layer and the totals
+        */
+		const RenderStats& getRenderStats() const;
+		/*!
+        \brief Sets a font used to display the render statistics of the last frame
+        when drawing with MapLayer::Debug. Statistics are not displayed if no font is set.
+        */
+		void setDebugFont(const sf::Font& font);
 
     private:
 		//properties which correspond to tmx
@@ -136,50 +412,135 @@ namespace tmx
 		sf::Uint16 m_tileWidth, m_tileHeight; //width / height of tiles
 		MapOrientation m_orientation;
 		float m_tileRatio; //width / height ratio of isometric tiles
+		bool m_staggerX; //staggered and hexagonal maps shift alternate columns if true, else alternate rows
+		bool m_staggerEven; //true if the even rows or columns are shifted rather than the odd ones
+		sf::Uint16 m_hexSideLength; //length of the flat side of a hexagonal tile
+		sf::Vector2f m_parallaxOrigin; //view centre at which parallax layers sit at their offset
 		std::map<std::string, std::string> m_properties;
 
 		mutable sf::FloatRect m_bounds; //bounding area of tiles visible on screen
 		mutable sf::Vector2f m_lastViewPos; //save recalc bounds if view not moved
+		mutable sf::Vector2f m_lastViewSize;
 		std::vector<std::string> m_searchPaths; //additional paths to search for tileset files
 
 		mutable std::vector<MapLayer> m_layers; //layers of map, including image and object layers
 		std::vector<std::unique_ptr<sf::Texture>> m_imageLayerTextures;
 		std::vector<std::unique_ptr<sf::Texture>> m_tilesetTextures; //textures created from complete sets used when drawing vertex arrays
 		const sf::Uint8 m_patchSize;
+		bool m_autoPatchSize;
+		sf::Vector2f m_expectedViewSize;
+		sf::Uint8 m_lodLevelCount;
+		bool m_depthSorting;
+		float m_minTexelDensity;
+		//the vertex order of a tile's texture coords for each combination of the flip bits in a GID
+		using FlipCorners = std::array<std::array<sf::Uint8, 4u>, 8u>;
+		FlipCorners m_flipCorners;
 		struct TileInfo final //holds texture coords and tileset id of a tile
 		{
 			std::array<sf::Vector2f, 4> Coords;
+			std::array<std::array<sf::Vector2f, 4u>, 8u> TexCoords; //half pixel inset coords, indexed by the GID's flip bits
 			sf::Vector2f Size;
 			sf::Uint16 TileSetId;
+			sf::Int32 AnimationId; //index into m_animations, or -1 if the tile isn't animated
 			TileInfo();
-			TileInfo(const sf::IntRect& rect, const sf::Vector2f& size, sf::Uint16 tilesetId);
+			TileInfo(const sf::IntRect& rect, const sf::Vector2f& size, sf::Uint16 tilesetId, const FlipCorners& flipCorners);
 		};
 		std::vector<TileInfo> m_tileInfo; //stores information on all the tilesets for creating vertex arrays
+		float m_tileOverhang; //how far the tallest tile extends above its grid cell
+
+		struct TileAnimation final //frames parsed from a tileset's animation element
+		{
+			TileAnimation() : duration(0){}
+			std::vector<std::pair<sf::Uint32, sf::Int64>> frames; //GID and duration in microseconds
+			sf::Int64 duration; //total length of all frames
+		};
+		std::vector<TileAnimation> m_animations;
+		std::vector<TileAnimationFrame> m_animationFrames; //current frame of each animation, shared with layer sets
+		sf::Time m_animationTime;
+
+		mutable RenderStats m_renderStats;
+		const sf::Font* m_debugFont;
 
 		sf::VertexArray m_gridVertices; //used to draw map grid in debug
 		bool m_mapLoaded, m_quadTreeAvailable;
+		bool m_quadTreeAutoTune;
 		//root node for quad tree partition
 		QuadTreeRoot m_rootNode;
+		SpatialGrid m_grid; //used in place of the quad tree if selected
+		SpatialIndex m_spatialIndex;
+		SpatialIndex m_nextSpatialIndex; //applied when the index is next rebuilt
+		sf::Vector2f m_gridCellSize;
+		StaticRTree m_staticTree; //objects on static layers, built at load time
+		ObjectIndex m_objectIndex; //objects by name, type and property, built at load time
+		std::vector<const MapObject*> m_addedObjects; //objects added with addObject(), not in any layer
+		std::unordered_set<const MapObject*> m_removedObjects; //layer objects removed with removeObject()
+		std::vector<const MapObject*> m_treeObjects; //objects gathered by updateQuadTree(), kept to reuse its storage
+		mutable WorkerPool m_workers; //runs batched queries
+		//returns true if the layer's objects belong in the static tree
+		static bool isStaticLayer(const MapLayer& layer);
+		//visits objects the segment may hit in the current spatial index and static tree, see QuadTreeRoot::visitRay()
+		template <typename T>
+		void visitRay(const sf::Vector2f& start, const sf::Vector2f& end, T visitor, const float& fraction) const
+		{
+			if(m_spatialIndex == SpatialIndex::Grid)
+				m_grid.visitRay(start, end, visitor, fraction);
+			else
+				m_rootNode.visitRay(start, end, visitor, fraction);
+			m_staticTree.visitRay(start, end, visitor, fraction);
+		}
+		//visits objects near the point in the current spatial index and static tree, see QuadTreeRoot::visitNearby()
+		template <typename T>
+		void visitNearby(const sf::Vector2f& point, T visitor, const float& maxDistance) const
+		{
+			if(m_spatialIndex == SpatialIndex::Grid)
+				m_grid.visitNearby(point, visitor, maxDistance);
+			else
+				m_rootNode.visitNearby(point, visitor, maxDistance);
+			m_staticTree.visitNearby(point, visitor, maxDistance);
+		}
 
 
 		bool loadFromXmlDoc(const pugi::xml_document& doc);
 		//resets any loaded map properties
 		void unload();
 		//sets the visible area of tiles to be drawn
-		void setDrawingBounds(const sf::View& view);
+		void setDrawingBounds(const sf::RenderTarget& rt) const;
+		//returns the area of the tile grid, in tiles, which may be drawn inside the given world bounds
+		sf::IntRect getTileBounds(const sf::FloatRect& bounds) const;
+		//returns the distance between the cells of unstaggered rows and columns
+		sf::Vector2f getCellStride() const;
+		//returns the offset of the staggered rows or columns of staggered and hexagonal maps
+		sf::Vector2f getStaggerOffset() const;
 
 		//utility functions for parsing map data
 		bool parseMapNode(const pugi::xml_node& mapNode);
 		bool parseTileSets(const pugi::xml_node& mapNode);
 		bool processTiles(const pugi::xml_node& tilesetNode);
+		void parseTileAnimations(const pugi::xml_node& tilesetNode, sf::Uint32 firstGid);
+		void setAnimationFrame(sf::Uint32 animation, sf::Uint32 frame);
         bool parseCollectionOfImages(const pugi::xml_node& tilesetNode);
 		bool parseLayer(const pugi::xml_node& layerNode);
+		//estimates the cost of drawing a layer with the given GIDs and patch size
+		MapLayer::PatchInfo calcPatchInfo(const std::vector<sf::Uint32>& tileGIDs, sf::Uint8 patchSize) const;
+		sf::Uint8 choosePatchSize(const std::vector<sf::Uint32>& tileGIDs) const;
+		//builds the vertices for a row of GIDs into the vertex buffer, then adds them to the layer's sets
+		void addTileRow(MapLayer& layer, sf::Uint16 y, const sf::Uint32* gids, sf::Vertex* vertices);
+		LayerSet& getLayerSet(MapLayer& layer, sf::Uint16 tilesetId);
         TileQuad* addTileToLayer(MapLayer& layer, sf::Uint16 x, sf::Uint16 y, sf::Uint32 gid, const sf::Vector2f& offset = sf::Vector2f());
 		bool parseObjectgroup(const pugi::xml_node& groupNode);
 		bool parseImageLayer(const pugi::xml_node& imageLayerNode);
 		void parseLayerProperties(const pugi::xml_node& propertiesNode, MapLayer& destLayer);
+		//reads the offset and parallax factor shared by all layer types
+		void parseLayerTransform(const pugi::xml_node& layerNode, MapLayer& destLayer);
 		void setIsometricCoords(MapLayer& layer);
 		void drawLayer(sf::RenderTarget& rt, MapLayer& layer, bool debug = false);
+		//gathers the counters from each layer after drawing
+		void updateRenderStats() const;
+		//gathers the counters from a single layer drawn on its own, and updates the totals
+		void updateRenderStats(sf::Uint16 index) const;
+		void updateLayerStats(sf::Uint16 index) const;
+		//draws the render stats as text in the top left of the target
+		void drawRenderStats(sf::RenderTarget& rt) const;
 		std::string fileFromPath(const std::string& path);
 
 		//sf::drawable
@@ -198,9 +559,8 @@ namespace tmx
 		std::map<std::string, std::shared_ptr<sf::Image> >m_cachedImages;
 		bool m_failedImage;
 
-        //Reading the flipped bits
-        std::vector<unsigned char> intToBytes(sf::Uint32 paramInt);
-        std::pair<sf::Uint32, std::bitset<3> > resolveRotation(sf::Uint32 gid);
+        //fills m_flipCorners by flipping a unit square with each combination of flip bits
+        void createFlipCorners();
 
         //Image flip functions
         void flipY(sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3);
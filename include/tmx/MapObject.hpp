@@ -91,6 +91,10 @@ namespace tmx
         */
 		std::string getPropertyString(const std::string& name);
 		/*!
+        \brief Returns the object's custom properties, by name
+        */
+		const std::map<std::string, std::string>& getProperties() const { return m_properties; }
+		/*!
         \brief Returns precomputed centre of mass, or zero for polylines
         */
 		sf::Vector2f getCentre() const { return m_centrePoint; }
@@ -101,15 +105,15 @@ namespace tmx
 		/*!
         \brief Returns the object's name
         */
-		std::string getName() const { return m_name; }
+		const std::string& getName() const { return m_name; }
 		/*!
         \brief Returns the object's type
         */
-		std::string getType() const { return m_type; }
+		const std::string& getType() const { return m_type; }
 		/*!
         \brief Returns the name of the object's parent layer
         */
-		std::string getParent() const { return m_parent; }
+		const std::string& getParent() const { return m_parent; }
 		/*!
         \brief Returns the object's AABB in world coordinates
         */
@@ -155,7 +159,10 @@ namespace tmx
 
 		/*!
         \brief Checks if an object contains given point in world coords.
-		Always returns false for polylines.
+		Always returns false for polylines. The test uses the object's points with its
+		origin, rotation and scale already applied, which are updated by createDebugShape()
+		and by this class's transform functions, so the object should not be transformed
+		through a reference to its sf::Transformable base.
         */
 		bool contains(sf::Vector2f point) const;
 		/*!
@@ -167,9 +174,10 @@ namespace tmx
         */
 		void createDebugShape(const sf::Color& colour);
 		/*!
-        \brief Draws debug shape to given target
+        \brief Draws debug shape to given target. Objects on layers with an offset
+        or parallax factor should pass the layer's transform, see MapLayer::getTransform()
         */
-		void drawDebugShape(sf::RenderTarget& rt) const;
+		void drawDebugShape(sf::RenderTarget& rt, const sf::Transform& layerTransform = sf::Transform::Identity) const;
 		/*!
         \brief Returns the first point of poly point member (if any) in world coordinates
         */
@@ -185,6 +193,19 @@ namespace tmx
         */
 		sf::Vector2f collisionNormal(const sf::Vector2f& start, const sf::Vector2f& end) const;
 		/*!
+        \brief Tests the segment from start to end, in world coords, against the edges of the
+        object's shape. Only hits nearer than fraction, the distance along the segment as a
+        ratio of its length, are found. Returns true if the segment hits an edge, setting
+        fraction to the ratio at the nearest hit and normal to the unit normal of the edge
+        facing the start of the segment
+        */
+		bool raycast(const sf::Vector2f& start, const sf::Vector2f& end, float& fraction, sf::Vector2f& normal) const;
+		/*!
+        \brief Returns the distance from the point, in world coords, to the nearest point of
+        the object's shape, or 0 if the shape contains the point
+        */
+		float distanceTo(const sf::Vector2f& point) const;
+		/*!
         \brief Creates a vector of segments making up the poly shape
         */
 		void createSegments();
@@ -221,6 +242,38 @@ namespace tmx
         \brief Set the position of the object in world coordinates
         */
         void move(const sf::Vector2f&);
+        /*!
+        \brief Set the rotation of the object, in degrees
+        */
+        void setRotation(float);
+        /*!
+        \brief Rotate the object by the given number of degrees
+        */
+        void rotate(float);
+        /*!
+        \brief Set the scale of the object
+        */
+        void setScale(float, float);
+        /*!
+        \brief Set the scale of the object
+        */
+        void setScale(const sf::Vector2f&);
+        /*!
+        \brief Multiply the object's scale by the given factors
+        */
+        void scale(float, float);
+        /*!
+        \brief Multiply the object's scale by the given factors
+        */
+        void scale(const sf::Vector2f&);
+        /*!
+        \brief Set the origin of the object's transforms, relative to its points
+        */
+        void setOrigin(float, float);
+        /*!
+        \brief Set the origin of the object's transforms, relative to its points
+        */
+        void setOrigin(const sf::Vector2f&);
 
 private:
 		//object properties, reflects those which are part of the tmx format
@@ -242,6 +295,12 @@ private:
 		//points may have negative values relative to the object's world position.
 		sf::FloatRect m_AABB; 
 
+		//poly points with the object's origin, rotation and scale applied, but not its position,
+		//so that moving the object doesn't invalidate them. Used by contains()
+		std::vector<sf::Vector2f> m_orientedPoints;
+		std::vector<float> m_edgeSlopes; //dx / dy of the edge ending at each oriented point
+		sf::FloatRect m_orientedBounds;
+
 		//returns centre of poly shape if available, else centre of
 		//bounding rectangle in world space
 		sf::Vector2f calcCentre() const;
@@ -249,6 +308,8 @@ private:
 		void calcTestValues();
 		//creates an AABB around the object based on its polygonal points, in world space
 		void createAABB();
+		//updates the oriented points and edge slopes used by contains()
+		void updateOrientedPoints();
 	};
 	using MapObjects =  std::vector<MapObject>;
 
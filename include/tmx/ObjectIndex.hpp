@@ -0,0 +1,150 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+Zlib License:
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+#ifndef OBJECT_INDEX_HPP_
+#define OBJECT_INDEX_HPP_
+
+#include <tmx/MapObject.hpp>
+
+#include <cassert>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tmx
+{
+	/*!
+    \brief A view of a contiguous range of object pointers, such as the result of an
+    ObjectIndex lookup. It doesn't own the pointers, and is invalidated when the index
+    it came from is modified
+    */
+	class ObjectSpan final
+	{
+	public:
+		ObjectSpan() : m_begin(nullptr), m_size(0u){}
+		explicit ObjectSpan(const std::vector<MapObject*>& objects)
+			: m_begin(objects.data()), m_size(objects.size()){}
+
+		MapObject* const* begin() const { return m_begin; }
+		MapObject* const* end() const { return m_begin + m_size; }
+		std::size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0u; }
+		MapObject* operator[](std::size_t index) const
+		{
+			assert(index < m_size);
+			return m_begin[index];
+		}
+
+	private:
+		MapObject* const* m_begin;
+		std::size_t m_size;
+	};
+
+	/*!
+    \brief Looks up MapObjects by name, type and custom property, so that objects can be
+    found without searching every layer and comparing strings. Each name, type, property
+    name and property value maps to a list of objects in a hash table, so lookups take
+    constant time and return a span of the objects in the order they were inserted.
+    Objects without a name or type aren't listed under an empty one. Lookups never
+    modify the index, so may run on several threads at once.
+    */
+	class TMX_EXPORT_API ObjectIndex final
+	{
+	public:
+		ObjectIndex() = default;
+
+		/*!
+        \brief Adds an object to the index. The object must stay at the same address until
+        it is removed or the index is cleared. Objects which are already in the index are
+        indexed again, so an object should be inserted again after its name, type or
+        properties have changed
+        */
+		void insert(MapObject& object);
+		/*!
+        \brief Removes an object from the index, using the name, type and properties it had
+        when it was last inserted. Returns false if the object wasn't in the index. Removing
+        an object takes time proportional to the number of objects sharing its keys
+        */
+		bool remove(const MapObject& object);
+		/*!
+        \brief Removes all objects from the index
+        */
+		void clear();
+		/*!
+        \brief Returns true if the object is in the index
+        */
+		bool contains(const MapObject& object) const { return m_keys.count(&object) != 0u; }
+		std::size_t size() const { return m_keys.size(); }
+		bool empty() const { return m_keys.empty(); }
+
+		/*!
+        \brief Returns the objects with the given name
+        */
+		ObjectSpan findByName(const std::string& name) const { return find(m_names, name); }
+		/*!
+        \brief Returns the objects with the given type
+        */
+		ObjectSpan findByType(const std::string& type) const { return find(m_types, type); }
+		/*!
+        \brief Returns the objects with a property of the given name, whatever its value
+        */
+		ObjectSpan findWithProperty(const std::string& name) const;
+		/*!
+        \brief Returns the objects with a property of the given name set to the given value
+        */
+		ObjectSpan findByProperty(const std::string& name, const std::string& value) const;
+
+	private:
+		using Bucket = std::vector<MapObject*>;
+		using BucketMap = std::unordered_map<std::string, Bucket>;
+
+		struct PropertyBuckets final
+		{
+			Bucket objects; //every object with the property
+			BucketMap values;
+		};
+
+		//keys under which each object was inserted, so it can be found again to remove it
+		struct Keys final
+		{
+			std::string name, type;
+			std::map<std::string, std::string> properties;
+		};
+
+		BucketMap m_names;
+		BucketMap m_types;
+		std::unordered_map<std::string, PropertyBuckets> m_properties;
+		std::unordered_map<const MapObject*, Keys> m_keys;
+
+		static ObjectSpan find(const BucketMap& buckets, const std::string& key);
+		static void erase(BucketMap& buckets, const std::string& key, const MapObject* object);
+		static void erase(Bucket& bucket, const MapObject* object);
+	};
+}
+
+#endif //OBJECT_INDEX_HPP_
@@ -0,0 +1,394 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+Zlib License:
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+#ifndef OBJECT_LIST_HPP_
+#define OBJECT_LIST_HPP_
+
+#include <tmx/MapObject.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace tmx
+{
+	/*!
+    \brief Selects which objects are returned by a spatial query
+    */
+	enum class SpatialQuery
+	{
+		Candidates, //every object in the nodes or cells which the test area touches
+		Overlapping //only objects whose AABB overlaps the test area
+	};
+
+	/*!
+    \brief Counts the work done by spatial queries, filled in when a pointer to one is passed
+    to a query function. Counts are added to those already stored, so one instance may total
+    several queries. Queries never modify the index itself, so may run on several threads at
+    once as long as each thread passes its own stats
+    */
+	struct SpatialQueryStats final
+	{
+		SpatialQueryStats() : nodesVisited(0u), objectsTested(0u), maxDepth(0u){}
+		sf::Uint32 nodesVisited; //tree nodes or grid cells
+		sf::Uint32 objectsTested; //objects stored in the nodes visited
+		sf::Uint16 maxDepth; //deepest tree level reached, where the root is 0
+	};
+
+	/*!
+    \brief Returns the distance, as a ratio of the length of direction, at which the segment
+    from start to start + direction enters the given box, or 0 if it starts inside. Returns
+    the largest float value if the segment misses the box
+    */
+	inline float rayEntry(const sf::Vector2f& start, const sf::Vector2f& direction, float left, float top, float right, float bottom)
+	{
+		float entry = 0.f;
+		float exit = 1.f;
+		auto clip = [&entry, &exit](float origin, float delta, float min, float max)
+		{
+			if(delta == 0.f) return (origin >= min && origin <= max);
+
+			float first = (min - origin) / delta;
+			float last = (max - origin) / delta;
+			if(first > last) std::swap(first, last);
+			entry = std::max(entry, first);
+			exit = std::min(exit, last);
+			return (entry <= exit);
+		};
+		if(!clip(start.x, direction.x, left, right) || !clip(start.y, direction.y, top, bottom))
+			return std::numeric_limits<float>::max();
+		return entry;
+	}
+
+	/*!
+    \brief Sorts the first count of the given pairs by their first member, the distance at
+    which a ray enters each child of a node. An insertion sort, as nodes have few children
+    */
+	template <typename T>
+	void sortByEntry(T* children, std::size_t count)
+	{
+		for(std::size_t i = 1u; i < count; ++i)
+		{
+			const T child = children[i];
+			std::size_t j = i;
+			for(; j > 0u && child.first < children[j - 1u].first; --j)
+				children[j] = children[j - 1u];
+			children[j] = child;
+		}
+	}
+
+	/*!
+    \brief Returns the distance from the point to the nearest point of the given box, or 0
+    if the point is inside it
+    */
+	inline float boxDistance(const sf::Vector2f& point, float left, float top, float right, float bottom)
+	{
+		const float x = std::max(0.f, std::max(left - point.x, point.x - right));
+		const float y = std::max(0.f, std::max(top - point.y, point.y - bottom));
+		return std::sqrt(x * x + y * y);
+	}
+
+	/*!
+    \brief A list of objects stored by a spatial index, along with the AABB of each object
+    as of when it was added or last updated. The bounds are kept as separate arrays so that
+    many objects can be tested against a query at once. Order is not preserved on removal
+    */
+	class TMX_EXPORT_API ObjectList final
+	{
+	public:
+		void add(MapObject* object, const sf::FloatRect& aabb)
+		{
+			m_objects.push_back(object);
+			m_left.push_back(aabb.left);
+			m_top.push_back(aabb.top);
+			m_right.push_back(aabb.left + aabb.width);
+			m_bottom.push_back(aabb.top + aabb.height);
+		}
+		//removes the object at the given index by moving the last object into its place
+		void remove(std::size_t index)
+		{
+			m_objects[index] = m_objects.back(); m_objects.pop_back();
+			m_left[index] = m_left.back(); m_left.pop_back();
+			m_top[index] = m_top.back(); m_top.pop_back();
+			m_right[index] = m_right.back(); m_right.pop_back();
+			m_bottom[index] = m_bottom.back(); m_bottom.pop_back();
+		}
+		//empties the list, keeping its storage
+		void clear()
+		{
+			m_objects.clear();
+			m_left.clear();
+			m_top.clear();
+			m_right.clear();
+			m_bottom.clear();
+		}
+		std::size_t size() const { return m_objects.size(); }
+		bool empty() const { return m_objects.empty(); }
+		MapObject* operator[](std::size_t index) const { return m_objects[index]; }
+		std::vector<MapObject*>::const_iterator begin() const { return m_objects.begin(); }
+		std::vector<MapObject*>::const_iterator end() const { return m_objects.end(); }
+
+		sf::FloatRect getBounds(std::size_t index) const
+		{
+			return sf::FloatRect(m_left[index], m_top[index], m_right[index] - m_left[index], m_bottom[index] - m_top[index]);
+		}
+		void setBounds(std::size_t index, const sf::FloatRect& aabb)
+		{
+			m_left[index] = aabb.left;
+			m_top[index] = aabb.top;
+			m_right[index] = aabb.left + aabb.width;
+			m_bottom[index] = aabb.top + aabb.height;
+		}
+
+		/*!
+        \brief Calls visitor with each object in the list, or with SpatialQuery::Overlapping
+        only those whose bounds overlap the test area
+        */
+		template <typename T>
+		void visit(const sf::FloatRect& bounds, T& visitor, SpatialQuery query) const
+		{
+			visit(0u, m_objects.size(), bounds, visitor, query);
+		}
+		/*!
+        \brief As visit(), for count objects starting at the given index
+        */
+		template <typename T>
+		void visit(std::size_t start, std::size_t count, const sf::FloatRect& bounds, T& visitor, SpatialQuery query) const
+		{
+			const std::size_t end = start + count;
+			if(query == SpatialQuery::Candidates)
+			{
+				for(auto i = start; i < end; ++i)
+					visitor(m_objects[i]);
+				return;
+			}
+
+			//test a block at a time, which lets the compiler vectorise the comparisons
+			std::array<sf::Uint8, 16u> overlaps;
+			for(std::size_t first = start; first < end; first += overlaps.size())
+			{
+				const std::size_t blockSize = std::min(overlaps.size(), end - first);
+				testOverlaps(first, blockSize, bounds, overlaps.data());
+				for(std::size_t i = 0u; i < blockSize; ++i)
+				{
+					if(overlaps[i]) visitor(m_objects[first + i]);
+				}
+			}
+		}
+		/*!
+        \brief Calls visitor for count objects starting at the given index whose AABB the
+        segment from start to start + direction enters before fraction, the distance along
+        it as a ratio of its length. Fraction is read before each object is tested, so the
+        visitor may lower it to skip objects beyond the nearest hit so far
+        */
+		template <typename T>
+		void visitRay(std::size_t start, std::size_t count, const sf::Vector2f& rayStart, const sf::Vector2f& direction, T& visitor, const float& fraction) const
+		{
+			for(auto i = start; i < start + count; ++i)
+			{
+				if(rayEntry(rayStart, direction, m_left[i], m_top[i], m_right[i], m_bottom[i]) < fraction)
+					visitor(m_objects[i]);
+			}
+		}
+		template <typename T>
+		void visitRay(const sf::Vector2f& rayStart, const sf::Vector2f& direction, T& visitor, const float& fraction) const
+		{
+			visitRay(0u, m_objects.size(), rayStart, direction, visitor, fraction);
+		}
+		/*!
+        \brief Calls visitor for count objects starting at the given index whose AABB lies
+        within maxDistance of the point. Max distance is read before each object is tested,
+        so the visitor may lower it
+        */
+		template <typename T>
+		void visitNearby(std::size_t start, std::size_t count, const sf::Vector2f& point, T& visitor, const float& maxDistance) const
+		{
+			for(auto i = start; i < start + count; ++i)
+			{
+				if(boxDistance(point, m_left[i], m_top[i], m_right[i], m_bottom[i]) <= maxDistance)
+					visitor(m_objects[i]);
+			}
+		}
+		template <typename T>
+		void visitNearby(const sf::Vector2f& point, T& visitor, const float& maxDistance) const
+		{
+			visitNearby(0u, m_objects.size(), point, visitor, maxDistance);
+		}
+
+	private:
+		std::vector<MapObject*> m_objects;
+		std::vector<float> m_left, m_top, m_right, m_bottom;
+
+		//sets the matching element of overlaps to 1 for each of count objects
+		//starting at first whose bounds overlap the test area, else 0
+		void testOverlaps(std::size_t first, std::size_t count, const sf::FloatRect& bounds, sf::Uint8* overlaps) const
+		{
+			const float* left = m_left.data() + first;
+			const float* top = m_top.data() + first;
+			const float* right = m_right.data() + first;
+			const float* bottom = m_bottom.data() + first;
+			const float boundsRight = bounds.left + bounds.width;
+			const float boundsBottom = bounds.top + bounds.height;
+
+			//no branches so this can be done several objects at a time
+			for(std::size_t i = 0u; i < count; ++i)
+			{
+				overlaps[i] = static_cast<sf::Uint8>((left[i] < boundsRight) & (right[i] > bounds.left)
+					& (top[i] < boundsBottom) & (bottom[i] > bounds.top));
+			}
+		}
+	};
+
+	/*!
+    \brief Maps each object held by a spatial index to the list holding it, such as a node or
+    cell, and to its slot in that list, so objects can be moved or removed without searching.
+    The entries are kept in a single open addressing hash table, so clearing keeps the storage
+    and an index can be rebuilt without allocating once the table is large enough
+    */
+	class TMX_EXPORT_API ObjectLocations final
+	{
+	public:
+		struct Location final
+		{
+			sf::Uint32 list;
+			sf::Uint32 slot;
+		};
+
+		ObjectLocations() : m_size(0u){}
+
+		//removes every entry, keeping the storage
+		void clear()
+		{
+			for(auto& entry : m_entries)
+				entry.object = nullptr;
+			m_size = 0u;
+		}
+		std::size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0u; }
+
+		//returns the location of the object, or null if it isn't stored. The pointer is
+		//invalidated when another object is assigned a location
+		Location* find(const MapObject* object)
+		{
+			if(m_entries.empty()) return nullptr;
+			for(auto i = home(object); m_entries[i].object; i = (i + 1u) & (m_entries.size() - 1u))
+			{
+				if(m_entries[i].object == object) return &m_entries[i].location;
+			}
+			return nullptr;
+		}
+		//sets the location of an object, adding it if it isn't already stored
+		void assign(const MapObject* object, sf::Uint32 list, std::size_t slot)
+		{
+			Location* location = find(object);
+			if(!location)
+			{
+				//keep the table at most half full so probe sequences stay short
+				if((m_size + 1u) * 2u > m_entries.size()) grow();
+
+				auto i = home(object);
+				while(m_entries[i].object) i = (i + 1u) & (m_entries.size() - 1u);
+				m_entries[i].object = object;
+				location = &m_entries[i].location;
+				m_size++;
+			}
+			location->list = list;
+			location->slot = static_cast<sf::Uint32>(slot);
+		}
+		//removes the object, which must be stored
+		void erase(const MapObject* object)
+		{
+			const std::size_t mask = m_entries.size() - 1u;
+			auto hole = home(object);
+			while(m_entries[hole].object != object)
+			{
+				assert(m_entries[hole].object);
+				hole = (hole + 1u) & mask;
+			}
+			m_entries[hole].object = nullptr;
+			m_size--;
+
+			//move back any later entries of the same probe sequence which would no longer be found
+			for(auto i = (hole + 1u) & mask; m_entries[i].object; i = (i + 1u) & mask)
+			{
+				const auto wanted = home(m_entries[i].object);
+				const bool reachable = (hole <= i) ? (wanted > hole && wanted <= i) : (wanted > hole || wanted <= i);
+				if(!reachable)
+				{
+					m_entries[hole] = m_entries[i];
+					m_entries[i].object = nullptr;
+					hole = i;
+				}
+			}
+		}
+		//appends every stored object to objects
+		void getObjects(std::vector<const MapObject*>& objects) const
+		{
+			for(const auto& entry : m_entries)
+			{
+				if(entry.object) objects.push_back(entry.object);
+			}
+		}
+
+	private:
+		struct Entry final
+		{
+			Entry() : object(nullptr){}
+			const MapObject* object;
+			Location location;
+		};
+		std::vector<Entry> m_entries; //size is always a power of two
+		std::size_t m_size;
+
+		std::size_t home(const MapObject* object) const
+		{
+			//the low bits of a pointer are alignment, so are mixed with the higher ones
+			std::size_t hash = static_cast<std::size_t>(reinterpret_cast<std::uintptr_t>(object) >> 3u);
+			hash ^= hash >> 15u;
+			hash *= 0x2c1b3c6du;
+			hash ^= hash >> 12u;
+			return hash & (m_entries.size() - 1u);
+		}
+		void grow()
+		{
+			std::vector<Entry> entries(std::max(static_cast<std::size_t>(16u), m_entries.size() * 2u));
+			entries.swap(m_entries);
+			m_size = 0u;
+			for(const auto& entry : entries)
+			{
+				if(entry.object) assign(entry.object, entry.location.list, entry.location.slot);
+			}
+		}
+	};
+}
+
+#endif //OBJECT_LIST_HPP_
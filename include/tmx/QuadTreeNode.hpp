@@ -26,91 +26,292 @@ it freely, subject to the following restrictions:
    source distribution.
 *********************************************************************/
 
+
 #ifndef QUADTREE_NODE_HPP_
 #define QUADTREE_NODE_HPP_
 
-#include <tmx/MapObject.hpp>
+#include <tmx/ObjectList.hpp>
+#include <tmx/SmallHeap.hpp>
 
-#include <memory>
+#include <array>
+#include <functional>
+#include <limits>
+#include <vector>
 
 namespace tmx
 {
+	/*!
+    \brief A single node of a QuadTreeRoot. Nodes are stored together in one array owned
+    by the tree, and refer to their children by index rather than by pointer
+    */
+	struct TMX_EXPORT_API QuadTreeNode final
+	{
+		QuadTreeNode() : firstChild(-1), parent(-1), level(0u){}
+		sf::FloatRect bounds;
+		sf::Int32 firstChild; //index of the first of four consecutive children, or -1 if not split
+		sf::Int32 parent; //-1 for the root node and for unused nodes
+		sf::Uint16 level;
+		ObjectList objects; //objects which don't fit entirely inside a child
+	};
+
     /*!
-    \brief Creates a node used to build quad trees for spatial partitioning of MapObjects.
+    \brief Quad tree used for spatial partitioning of MapObjects.
     Example usage: create a root node the size of the viewable area, and insert each
     available map object. Then test the root node by calling retrieve passing for example
     the AABB of a sprite. The resulting vector will contain pointers to any objects contained
     in quads which are them selves contained, or intersected, by the sprites AABB. These can
-    then be collision tested.   
+    then be collision tested.
+    Nodes are kept in a single contiguous array, with the four children of a node stored
+    next to each other. Clearing the tree keeps the array and each node's object list so
+    that rebuilding the tree every frame doesn't reallocate.
+    Objects which move can be relocated individually with update(), so the tree doesn't
+    need rebuilding when only a few objects move. Nodes are merged back into their parent
+    when objects leave them and their children no longer need splitting.
     */
-
-	class TMX_EXPORT_API QuadTreeNode
+    class TMX_EXPORT_API QuadTreeRoot final : public sf::Drawable
 	{
-        friend class QuadTreeRoot;
 	public:
-		QuadTreeNode(sf::Uint16 level = 0, const sf::FloatRect& bounds = sf::FloatRect(0.f, 0.f, 1.f, 1.f));
-		virtual ~QuadTreeNode() = default;
+		using Query = SpatialQuery;
 
 		/*!
-        \brief Fills a vector with references to all objects which
-		appear in quads which are contained or intersect bounds.
+        \brief Controls when nodes are split
         */
-		std::vector<MapObject*> retrieve(const sf::FloatRect& bounds, sf::Uint16& currentDepth);
+		struct TMX_EXPORT_API Settings final
+		{
+			Settings() : maxObjects(5u), maxLevels(5u){}
+			sf::Uint16 maxObjects; //objects a node may hold before it is split
+			sf::Uint16 maxLevels; //levels below the root which may be created by splitting
+		};
+
 		/*!
-        \brief Inserts a reference to the object into the node's object list
+        \brief Describes the current shape of the tree
         */
-		void insert(const MapObject& object);
-	protected:
+		struct TMX_EXPORT_API Stats final
+		{
+			Stats() : nodeCount(0u), leafCount(0u), objectCount(0u), maxObjectsPerLeaf(0u), averageObjectsPerLeaf(0.f){}
+			sf::Uint32 nodeCount; //including the root
+			sf::Uint32 leafCount;
+			sf::Uint32 objectCount;
+			sf::Uint32 maxObjectsPerLeaf;
+			float averageObjectsPerLeaf;
+			std::vector<sf::Uint32> depthHistogram; //number of objects held at each level, starting with the root
+		};
 
-		sf::Uint16 m_level;
-		sf::FloatRect m_bounds;
-		std::vector<MapObject*> m_objects; //objects contained in current node
-		std::vector< std::shared_ptr<QuadTreeNode> > m_children; //vector of child nodes
+		explicit QuadTreeRoot(const sf::FloatRect& bounds = sf::FloatRect(0.f, 0.f, 1.f, 1.f));
 
 		/*!
-        \brief Returns the index of the child node into which the givens bounds fits.
-		Returns -1 if doesn't completely fit a child. Numbered anti-clockwise
-		from top right node.
+        \brief Sets when nodes are split. If the tree already contains objects
+        it is rebuilt with the new settings
         */
-		sf::Int16 getIndex(const sf::FloatRect& bounds);
-
+		void setSettings(const Settings& settings);
+		const Settings& getSettings() const { return m_settings; }
 		/*!
-        \brief Divides node by creating 4 children
+        \brief Picks settings for a tree covering root area which will contain objects with
+        the given bounds. The depth is chosen so that the smallest nodes are still a few times
+        the size of a typical object, as objects larger than a node can't be moved into its
+        children. Nodes hold more objects before splitting when object sizes vary widely,
+        as more of them end up straddling the edges of children anyway
         */
-		void split(void);
-
-        void getVertices(std::vector<sf::Vertex>&);
-
-	};
-
-	/*!
-    \brief Specialisation of QuadTreeNode for counting tree depth
-    */
-    class TMX_EXPORT_API QuadTreeRoot final : public QuadTreeNode, public sf::Drawable
-	{
-	public:
-		QuadTreeRoot(sf::Uint16 level = 0, const sf::FloatRect& bounds = sf::FloatRect(0.f, 0.f, 1.f, 1.f))
-			: QuadTreeNode(level, bounds), m_depth(0u), m_searchDepth(0u){};
+		static Settings autoTune(const sf::FloatRect& rootArea, const std::vector<sf::FloatRect>& objectBounds);
+		/*!
+        \brief Returns statistics describing the current shape of the tree. This visits
+        every node so is intended for debugging and tuning rather than every frame
+        */
+		Stats getStats() const;
 
 		/*!
         \brief Clears node and all children
         */
 		void clear(const sf::FloatRect& newBounds);
 		/*!
+        \brief Inserts a reference to the object into the deepest node which completely contains it.
+        Objects which are already in the tree are updated instead
+        */
+		void insert(const MapObject& object);
+		/*!
+        \brief Removes the object from the tree. Returns false if the object wasn't in the tree
+        */
+		bool remove(const MapObject& object);
+		/*!
+        \brief Moves the object to the node matching its current AABB, if it has left its node.
+        Call this after moving an object rather than rebuilding the whole tree. Objects which
+        have moved entirely outside the root node are removed, and objects not yet in the
+        tree are inserted
+        */
+		void update(const MapObject& object);
+		/*!
         \brief Retrieves all objects in quads which contains or intersect test area
         */
-		std::vector<MapObject*> retrieve(const sf::FloatRect& bounds)
+		std::vector<MapObject*> retrieve(const sf::FloatRect& bounds) const;
+		/*!
+        \brief Appends all objects in quads which contain or intersect test area to results,
+        without clearing it. Reuse the same vector to query without allocating. With
+        Query::Overlapping only objects whose AABB, as of when they were inserted or last
+        updated, overlaps the test area are returned. Each object appears once in the results.
+        If stats isn't null the work done by the query is added to it
+        */
+		void retrieve(const sf::FloatRect& bounds, std::vector<MapObject*>& results, Query query = Query::Candidates, SpatialQueryStats* stats = nullptr) const;
+		/*!
+        \brief Calls visitor, a function or function object taking a MapObject*, for each
+        object in quads which contain or intersect test area, or with Query::Overlapping
+        for each object whose AABB overlaps the test area
+        */
+		template <typename T>
+		void visit(const sf::FloatRect& bounds, T visitor, Query query = Query::Candidates, SpatialQueryStats* stats = nullptr) const
 		{
-			return QuadTreeNode::retrieve(bounds, m_searchDepth);
+			visitNode(0u, bounds, visitor, query, stats);
 		}
+		/*!
+        \brief Calls visitor for each object whose AABB the segment from start to end enters
+        before fraction, the distance along it as a ratio of its length. Nodes are visited in
+        the order the segment enters them, and fraction is read before each node and object
+        is tested, so a visitor which lowers it to the nearest hit found so far skips the
+        rest of the tree beyond that hit
+        */
+		template <typename T>
+		void visitRay(const sf::Vector2f& start, const sf::Vector2f& end, T visitor, const float& fraction) const
+		{
+			visitRayNode(0u, start, end - start, visitor, fraction);
+		}
+		/*!
+        \brief Calls visitor for each object whose AABB lies within maxDistance of the point.
+        Nodes are visited best first, nearest to the point first, and max distance is read
+        before each node and object is tested, so a visitor searching for the nearest objects
+        may lower it as they are found to skip the rest of the tree
+        */
+		template <typename T>
+		void visitNearby(const sf::Vector2f& point, T visitor, const float& maxDistance) const;
 
 	private:
-		//total depth of tree, and depth reached when querying
-		sf::Uint16 m_depth, m_searchDepth;
+		Settings m_settings;
+		std::vector<QuadTreeNode> m_nodes; //the root node is always first
+		sf::Uint32 m_nodeCount; //nodes in use. Any others are kept for reuse after clearing
+		std::vector<sf::Uint32> m_freeNodes; //first nodes of blocks of children released by merging
+		ObjectLocations m_locations; //node holding each object and its slot in the node
+
+		void insert(sf::Uint32 nodeIndex, MapObject* object, const sf::FloatRect& aabb);
+		//returns the index of the deepest existing node below the given node which contains aabb
+		sf::Uint32 findNode(sf::Uint32 nodeIndex, const sf::FloatRect& aabb) const;
+		void removeFromNode(sf::Uint32 nodeIndex, std::size_t slot);
+		/*!
+        \brief Merges the children of the node's ancestors back into them while they
+        hold few enough objects, starting with the node's own children
+        */
+		void merge(sf::Uint32 nodeIndex);
+		/*!
+        \brief Divides node by adding 4 children to the end of the node array
+        */
+		void split(sf::Uint32 nodeIndex);
+		/*!
+        \brief Returns the index of the child of the given node bounds into which the
+		object bounds fits. Returns -1 if doesn't completely fit a child. Numbered
+		anti-clockwise from top right node.
+        */
+		static sf::Int16 getIndex(const sf::FloatRect& nodeBounds, const sf::FloatRect& bounds);
+
+		template <typename T>
+		void visitNode(sf::Uint32 nodeIndex, const sf::FloatRect& bounds, T& visitor, Query query, SpatialQueryStats* stats) const;
+		template <typename T>
+		void visitRayNode(sf::Uint32 nodeIndex, const sf::Vector2f& start, const sf::Vector2f& direction, T& visitor, const float& fraction) const;
+		/*!
+        \brief Returns the left, top, right and bottom of a node's bounds, made unbounded on
+        any side at the edge of the root as objects reaching outside the root are kept there
+        */
+		std::array<float, 4u> getSearchBounds(sf::Uint32 nodeIndex) const
+		{
+			const sf::FloatRect& root = m_nodes[0].bounds;
+			const sf::FloatRect& bounds = m_nodes[nodeIndex].bounds;
+			const float infinity = std::numeric_limits<float>::infinity();
+			return
+			{{
+				(bounds.left <= root.left) ? -infinity : bounds.left,
+				(bounds.top <= root.top) ? -infinity : bounds.top,
+				(bounds.left + bounds.width >= root.left + root.width) ? infinity : bounds.left + bounds.width,
+				(bounds.top + bounds.height >= root.top + root.height) ? infinity : bounds.top + bounds.height
+			}};
+		}
 
         void draw(sf::RenderTarget& rt, sf::RenderStates states) const override;
 	};
+
+	template <typename T>
+	void QuadTreeRoot::visitNode(sf::Uint32 nodeIndex, const sf::FloatRect& bounds, T& visitor, Query query, SpatialQueryStats* stats) const
+	{
+		const QuadTreeNode& node = m_nodes[nodeIndex];
+		if(stats)
+		{
+			stats->nodesVisited++;
+			stats->objectsTested += static_cast<sf::Uint32>(node.objects.size());
+			stats->maxDepth = std::max(stats->maxDepth, node.level);
+		}
+		if(node.firstChild != -1)
+		{
+			//only descend into the child containing bounds, or else any children it intersects
+			const sf::Int16 index = getIndex(node.bounds, bounds);
+			if(index != -1)
+			{
+				visitNode(node.firstChild + index, bounds, visitor, query, stats);
+			}
+			else
+			{
+				for(auto i = node.firstChild; i < node.firstChild + 4; ++i)
+				{
+					if(bounds.intersects(m_nodes[i].bounds))
+						visitNode(i, bounds, visitor, query, stats);
+				}
+			}
+		}
+		//and then objects in this node
+		node.objects.visit(bounds, visitor, query);
+	}
+
+	template <typename T>
+	void QuadTreeRoot::visitRayNode(sf::Uint32 nodeIndex, const sf::Vector2f& start, const sf::Vector2f& direction, T& visitor, const float& fraction) const
+	{
+		const QuadTreeNode& node = m_nodes[nodeIndex];
+		node.objects.visitRay(start, direction, visitor, fraction);
+		if(node.firstChild == -1) return;
+
+		//visit the children in the order the ray enters them
+		std::array<std::pair<float, sf::Int32>, 4u> children;
+		std::size_t childCount = 0u;
+		for(auto i = node.firstChild; i < node.firstChild + 4; ++i)
+		{
+			const auto bounds = getSearchBounds(i);
+			const float entry = rayEntry(start, direction, bounds[0], bounds[1], bounds[2], bounds[3]);
+			if(entry < fraction) children[childCount++] = std::make_pair(entry, i);
+		}
+		sortByEntry(children.data(), childCount);
+		for(auto i = 0u; i < childCount; ++i)
+		{
+			if(children[i].first < fraction)
+				visitRayNode(children[i].second, start, direction, visitor, fraction);
+		}
+	}
+
+	template <typename T>
+	void QuadTreeRoot::visitNearby(const sf::Vector2f& point, T visitor, const float& maxDistance) const
+	{
+		//nodes waiting to be searched, nearest first
+		using Entry = std::pair<float, sf::Int32>;
+		SmallHeap<Entry, 64u, std::greater<Entry>> queue; //only allocates for very deep searches
+		queue.push(std::make_pair(0.f, 0));
+		while(!queue.empty() && queue.top().first <= maxDistance)
+		{
+			const QuadTreeNode& node = m_nodes[queue.top().second];
+			queue.pop();
+			node.objects.visitNearby(point, visitor, maxDistance);
+			if(node.firstChild == -1) continue;
+
+			for(auto i = node.firstChild; i < node.firstChild + 4; ++i)
+			{
+				const auto bounds = getSearchBounds(i);
+				const float distance = boxDistance(point, bounds[0], bounds[1], bounds[2], bounds[3]);
+				if(distance <= maxDistance) queue.push(std::make_pair(distance, i));
+			}
+		}
+	}
 };
 
 
-#endif //QUADTREE_NODE_HPP_
\ No newline at end of file
+#endif //QUADTREE_NODE_HPP_
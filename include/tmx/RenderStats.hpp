@@ -0,0 +1,91 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+Zlib License:
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+#ifndef RENDER_STATS_HPP_
+#define RENDER_STATS_HPP_
+
+#include <tmx/Export.hpp>
+
+#include <SFML/Config.hpp>
+#include <SFML/System/Time.hpp>
+
+#include <vector>
+
+namespace tmx
+{
+	/*!
+    \brief Statistics describing the cost of the most recently drawn frame of a map
+    */
+	struct TMX_EXPORT_API RenderStats final
+	{
+		/*!
+        \brief Counters gathered when drawing a LayerSet, a MapLayer or the whole map
+        */
+		struct Counters final
+		{
+			Counters()
+				: drawCalls(0u), vertices(0u), visiblePatches(0u), culledPatches(0u), lodChunks(0u), dirtyQuads(0u), animatedQuads(0u){}
+
+			sf::Uint32 drawCalls;
+			sf::Uint32 vertices; //number of vertices submitted to the render target
+			sf::Uint32 visiblePatches;
+			sf::Uint32 culledPatches; //patches containing tiles which were skipped
+			sf::Uint32 lodChunks; //downsampled chunks drawn in place of patches when zoomed out
+			sf::Uint32 dirtyQuads; //moved or hidden quads updated before drawing
+			sf::Uint32 animatedQuads; //animated tile quads which changed frame before drawing
+
+			Counters& operator += (const Counters& rhs)
+			{
+				drawCalls += rhs.drawCalls;
+				vertices += rhs.vertices;
+				visiblePatches += rhs.visiblePatches;
+				culledPatches += rhs.culledPatches;
+				lodChunks += rhs.lodChunks;
+				dirtyQuads += rhs.dirtyQuads;
+				animatedQuads += rhs.animatedQuads;
+				return *this;
+			}
+		};
+
+		/*!
+        \brief Counters for a single map layer
+        */
+		struct Layer final
+		{
+			Counters counters; //sum of the layer's layer sets, plus any image layer sprites
+			std::vector<Counters> layerSets; //in the same order as MapLayer::layerSets
+		};
+
+		Counters total;
+		std::vector<Layer> layers; //in the same order as MapLoader::getLayers()
+		sf::Time cullTime; //time spent culling patches, zero if the view didn't change
+		sf::Time drawTime; //time spent submitting layers to the render target
+	};
+}
+
+#endif //RENDER_STATS_HPP_
@@ -0,0 +1,90 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+Zlib License:
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+#ifndef SMALL_HEAP_HPP_
+#define SMALL_HEAP_HPP_
+
+#include <SFML/System/NonCopyable.hpp>
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <vector>
+
+namespace tmx
+{
+	/*!
+    \brief A priority queue which holds up to N entries in place, and only allocates once it
+    holds more. As with std::priority_queue the top entry is the one which Compare orders
+    after all the others, so std::greater puts the smallest entry on top. Used by searches
+    which would otherwise allocate a queue for every query
+    */
+	template <typename T, std::size_t N, typename Compare = std::less<T>>
+	class SmallHeap final : private sf::NonCopyable
+	{
+	public:
+		SmallHeap() : m_size(0u){}
+
+		bool empty() const { return m_size == 0u; }
+		std::size_t size() const { return m_size; }
+		const T& top() const { return data()[0]; }
+
+		void push(const T& value)
+		{
+			if(m_spill.empty() && m_size == N)
+			{
+				m_spill.reserve(N * 2u);
+				m_spill.assign(m_inline.begin(), m_inline.end());
+			}
+
+			if(m_spill.empty())
+				m_inline[m_size] = value;
+			else
+				m_spill.push_back(value);
+			m_size++;
+			std::push_heap(data(), data() + m_size, Compare());
+		}
+
+		void pop()
+		{
+			std::pop_heap(data(), data() + m_size, Compare());
+			m_size--;
+			if(!m_spill.empty()) m_spill.pop_back(); //back to the inline entries once empty
+		}
+
+	private:
+		std::array<T, N> m_inline;
+		std::vector<T> m_spill; //used in place of the inline entries once they overflow
+		std::size_t m_size;
+
+		T* data() { return m_spill.empty() ? m_inline.data() : m_spill.data(); }
+		const T* data() const { return m_spill.empty() ? m_inline.data() : m_spill.data(); }
+	};
+}
+
+#endif //SMALL_HEAP_HPP_
@@ -0,0 +1,260 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+Zlib License:
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+#ifndef SPATIAL_GRID_HPP_
+#define SPATIAL_GRID_HPP_
+
+#include <tmx/ObjectList.hpp>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace tmx
+{
+	/*!
+    \brief Loose uniform grid used for spatial partitioning of MapObjects, as an alternative
+    to QuadTreeRoot with the same insert, update and query functions. Each object is stored
+    in the single cell containing the centre of its AABB, and queries are widened by half a
+    cell to find objects reaching into the test area from neighbouring cells. Objects larger
+    than a cell are kept in a separate list which every query tests. This suits maps whose
+    objects are of a similar size and spread over the map, where it is faster than a quad
+    tree as finding a cell takes no traversal.
+    */
+	class TMX_EXPORT_API SpatialGrid final : public sf::Drawable
+	{
+	public:
+		using Query = SpatialQuery;
+
+		explicit SpatialGrid(const sf::FloatRect& bounds = sf::FloatRect(0.f, 0.f, 1.f, 1.f), const sf::Vector2f& cellSize = sf::Vector2f(64.f, 64.f));
+
+		/*!
+        \brief Sets the size of each cell. Takes effect the next time the grid is cleared.
+        Around twice the size of a typical object usually works well
+        */
+		void setCellSize(const sf::Vector2f& size);
+		const sf::Vector2f& getCellSize() const { return m_cellSize; }
+
+		/*!
+        \brief Removes all objects and resizes the grid to cover the given area. Objects
+        outside the area are stored in the cells at its edge
+        */
+		void clear(const sf::FloatRect& newBounds);
+		/*!
+        \brief Inserts a reference to the object. Objects which are already in the grid
+        are updated instead
+        */
+		void insert(const MapObject& object);
+		/*!
+        \brief Removes the object from the grid. Returns false if the object wasn't in the grid
+        */
+		bool remove(const MapObject& object);
+		/*!
+        \brief Moves the object to the cell matching its current AABB after it has moved
+        */
+		void update(const MapObject& object);
+		/*!
+        \brief Retrieves all objects in cells which may overlap the test area
+        */
+		std::vector<MapObject*> retrieve(const sf::FloatRect& bounds) const;
+		/*!
+        \brief Appends objects in cells which may overlap the test area to results, without
+        clearing it. With Query::Overlapping only objects whose AABB overlaps the test area
+        are returned. Each object appears once in the results. If stats isn't null the work
+        done by the query is added to it
+        */
+		void retrieve(const sf::FloatRect& bounds, std::vector<MapObject*>& results, Query query = Query::Candidates, SpatialQueryStats* stats = nullptr) const;
+		/*!
+        \brief Calls visitor, a function or function object taking a MapObject*, for each
+        object which would be returned by retrieve()
+        */
+		template <typename T>
+		void visit(const sf::FloatRect& bounds, T visitor, Query query = Query::Candidates, SpatialQueryStats* stats = nullptr) const;
+		/*!
+        \brief Calls visitor for each object whose AABB the segment from start to end enters
+        before fraction, the distance along it as a ratio of its length. Cells are visited in
+        the order the segment passes through them, and fraction is read before each cell and
+        object is tested, so a visitor which lowers it to the nearest hit found so far skips
+        the cells beyond that hit
+        */
+		template <typename T>
+		void visitRay(const sf::Vector2f& start, const sf::Vector2f& end, T visitor, const float& fraction) const;
+		/*!
+        \brief Calls visitor for each object whose AABB lies within maxDistance of the point.
+        Cells are visited in rings spreading out from the point, and max distance is read
+        before each ring and object is tested, so a visitor searching for the nearest objects
+        may lower it as they are found to skip the cells further out
+        */
+		template <typename T>
+		void visitNearby(const sf::Vector2f& point, T visitor, const float& maxDistance) const;
+
+	private:
+		sf::FloatRect m_bounds;
+		sf::Vector2f m_cellSize;
+		sf::Vector2f m_nextCellSize;
+		sf::Vector2i m_cellCount;
+		std::vector<ObjectList> m_cells; //row by row, followed by the list of large objects
+		ObjectLocations m_locations; //cell holding each object and its slot in the cell
+
+		//returns the index of the cell an object with the given bounds belongs in
+		sf::Uint32 getCellIndex(const sf::FloatRect& aabb) const;
+		//returns the range of cells, inclusive, which objects overlapping the bounds may be stored in
+		void getCellRange(const sf::FloatRect& bounds, sf::Vector2i& start, sf::Vector2i& end) const;
+		void removeFromCell(sf::Uint32 cellIndex, std::size_t slot);
+
+		void draw(sf::RenderTarget& rt, sf::RenderStates states) const override;
+	};
+
+	template <typename T>
+	void SpatialGrid::visit(const sf::FloatRect& bounds, T visitor, Query query, SpatialQueryStats* stats) const
+	{
+		sf::Vector2i start, end;
+		getCellRange(bounds, start, end);
+		for(auto y = start.y; y <= end.y; ++y)
+		{
+			for(auto x = start.x; x <= end.x; ++x)
+			{
+				const ObjectList& cell = m_cells[y * m_cellCount.x + x];
+				if(stats) stats->objectsTested += static_cast<sf::Uint32>(cell.size());
+				cell.visit(bounds, visitor, query);
+			}
+		}
+		m_cells.back().visit(bounds, visitor, query);
+
+		if(stats)
+		{
+			stats->nodesVisited += static_cast<sf::Uint32>((end.x - start.x + 1) * (end.y - start.y + 1) + 1);
+			stats->objectsTested += static_cast<sf::Uint32>(m_cells.back().size());
+		}
+	}
+
+	template <typename T>
+	void SpatialGrid::visitRay(const sf::Vector2f& start, const sf::Vector2f& end, T visitor, const float& fraction) const
+	{
+		const sf::Vector2f direction = end - start;
+		m_cells.back().visitRay(start, direction, visitor, fraction);
+
+		//objects outside the grid are stored in the cells at its edge, so a segment
+		//leaving the grid tests every cell which may hold objects it touches
+		const sf::FloatRect rayBounds(std::min(start.x, end.x), std::min(start.y, end.y), std::abs(direction.x), std::abs(direction.y));
+		if(rayBounds.left < m_bounds.left || rayBounds.top < m_bounds.top
+			|| rayBounds.left + rayBounds.width > m_bounds.left + m_bounds.width
+			|| rayBounds.top + rayBounds.height > m_bounds.top + m_bounds.height)
+		{
+			sf::Vector2i first, last;
+			getCellRange(rayBounds, first, last);
+			for(auto y = first.y; y <= last.y; ++y)
+			{
+				for(auto x = first.x; x <= last.x; ++x)
+					m_cells[y * m_cellCount.x + x].visitRay(start, direction, visitor, fraction);
+			}
+			return;
+		}
+
+		//step from cell to cell along the segment. Objects reach up to half a cell out of
+		//their own cell, so the neighbours of each cell are tested too, skipping those
+		//already tested as neighbours of the previous cell
+		sf::Vector2i cell(
+			std::max(0, std::min(static_cast<int>(std::floor((start.x - m_bounds.left) / m_cellSize.x)), m_cellCount.x - 1)),
+			std::max(0, std::min(static_cast<int>(std::floor((start.y - m_bounds.top) / m_cellSize.y)), m_cellCount.y - 1)));
+		const sf::Vector2i step((direction.x < 0.f) ? -1 : 1, (direction.y < 0.f) ? -1 : 1);
+		const float infinity = std::numeric_limits<float>::infinity();
+		const sf::Vector2f delta((direction.x != 0.f) ? m_cellSize.x / std::abs(direction.x) : infinity,
+			(direction.y != 0.f) ? m_cellSize.y / std::abs(direction.y) : infinity);
+		sf::Vector2f next( //distance to the next cell boundary on each axis
+			(direction.x != 0.f) ? (m_bounds.left + (cell.x + (step.x > 0 ? 1 : 0)) * m_cellSize.x - start.x) / direction.x : infinity,
+			(direction.y != 0.f) ? (m_bounds.top + (cell.y + (step.y > 0 ? 1 : 0)) * m_cellSize.y - start.y) / direction.y : infinity);
+
+		sf::Vector2i previous(-2, -2);
+		float cellEntry = 0.f;
+		while(cellEntry < fraction)
+		{
+			for(auto y = std::max(0, cell.y - 1); y <= std::min(m_cellCount.y - 1, cell.y + 1); ++y)
+			{
+				for(auto x = std::max(0, cell.x - 1); x <= std::min(m_cellCount.x - 1, cell.x + 1); ++x)
+				{
+					if(std::abs(x - previous.x) > 1 || std::abs(y - previous.y) > 1)
+						m_cells[y * m_cellCount.x + x].visitRay(start, direction, visitor, fraction);
+				}
+			}
+			previous = cell;
+
+			if(next.x < next.y)
+			{
+				cellEntry = next.x;
+				next.x += delta.x;
+				cell.x += step.x;
+			}
+			else
+			{
+				cellEntry = next.y;
+				next.y += delta.y;
+				cell.y += step.y;
+			}
+			if(cell.x < 0 || cell.x >= m_cellCount.x || cell.y < 0 || cell.y >= m_cellCount.y) break;
+		}
+	}
+
+	template <typename T>
+	void SpatialGrid::visitNearby(const sf::Vector2f& point, T visitor, const float& maxDistance) const
+	{
+		m_cells.back().visitNearby(point, visitor, maxDistance);
+
+		//objects reach up to half a cell out of their own cell, so those in a ring of cells
+		//at a given number of cells from the point's cell are at least this far away. Points
+		//and objects outside the grid are clamped to its edge, which keeps the bound safe
+		const float cellSize = std::min(m_cellSize.x, m_cellSize.y);
+		const sf::Vector2i centre(
+			std::max(0, std::min(static_cast<int>(std::floor((point.x - m_bounds.left) / m_cellSize.x)), m_cellCount.x - 1)),
+			std::max(0, std::min(static_cast<int>(std::floor((point.y - m_bounds.top) / m_cellSize.y)), m_cellCount.y - 1)));
+
+		for(auto ring = 0; ; ++ring)
+		{
+			if((static_cast<float>(ring) - 1.5f) * cellSize > maxDistance) break;
+
+			const int left = centre.x - ring;
+			const int top = centre.y - ring;
+			const int right = centre.x + ring;
+			const int bottom = centre.y + ring;
+			if(left < 0 && top < 0 && right >= m_cellCount.x && bottom >= m_cellCount.y) break;
+
+			for(auto y = std::max(0, top); y <= std::min(bottom, m_cellCount.y - 1); ++y)
+			{
+				//only the edges of the ring, apart from its top and bottom rows
+				const int step = (y == top || y == bottom) ? 1 : right - left;
+				for(auto x = left; x <= right; x += std::max(1, step))
+				{
+					if(x >= 0 && x < m_cellCount.x)
+						m_cells[y * m_cellCount.x + x].visitNearby(point, visitor, maxDistance);
+				}
+			}
+		}
+	}
+}
+
+#endif //SPATIAL_GRID_HPP_
@@ -0,0 +1,203 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+Zlib License:
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+#ifndef STATIC_RTREE_HPP_
+#define STATIC_RTREE_HPP_
+
+#include <tmx/ObjectList.hpp>
+#include <tmx/SmallHeap.hpp>
+
+#include <functional>
+#include <vector>
+
+namespace tmx
+{
+	/*!
+    \brief R-tree of MapObjects which never move, such as collision geometry. The tree is
+    bulk loaded in a single pass with Sort-Tile-Recursive packing, which fills every node and
+    keeps sibling nodes from overlapping, and is stored in one flat array. It can't be
+    modified once built, so may be queried from several threads at once without locking.
+    */
+	class TMX_EXPORT_API StaticRTree final : public sf::Drawable
+	{
+	public:
+		using Query = SpatialQuery;
+
+		StaticRTree() = default;
+
+		/*!
+        \brief Replaces the contents of the tree with the given objects. The objects
+        must stay at the same address and must not move until the tree is rebuilt or cleared
+        */
+		void build(const std::vector<const MapObject*>& objects);
+		/*!
+        \brief Removes all objects from the tree
+        */
+		void clear();
+		/*!
+        \brief Returns true if the object was in the list passed to build()
+        */
+		bool contains(const MapObject& object) const;
+		std::size_t size() const { return m_objects.size(); }
+		bool empty() const { return m_objects.empty(); }
+		/*!
+        \brief Appends objects in leaves whose bounds overlap the test area to results,
+        without clearing it. With Query::Overlapping only objects whose AABB overlaps the
+        test area are returned. If stats isn't null the work done by the query is added to it
+        */
+		void retrieve(const sf::FloatRect& bounds, std::vector<MapObject*>& results, Query query = Query::Candidates, SpatialQueryStats* stats = nullptr) const;
+		/*!
+        \brief Calls visitor, a function or function object taking a MapObject*, for each
+        object which would be returned by retrieve()
+        */
+		template <typename T>
+		void visit(const sf::FloatRect& bounds, T visitor, Query query = Query::Candidates, SpatialQueryStats* stats = nullptr) const
+		{
+			if(!m_nodes.empty())
+				visitNode(static_cast<sf::Uint32>(m_nodes.size() - 1u), 0u, bounds, visitor, query, stats);
+		}
+		/*!
+        \brief Calls visitor for each object whose AABB the segment from start to end enters
+        before fraction, the distance along it as a ratio of its length. Nodes are visited in
+        the order the segment enters them, and fraction is read before each node and object
+        is tested, so a visitor which lowers it to the nearest hit found so far skips the
+        rest of the tree beyond that hit
+        */
+		template <typename T>
+		void visitRay(const sf::Vector2f& start, const sf::Vector2f& end, T visitor, const float& fraction) const
+		{
+			if(!m_nodes.empty())
+				visitRayNode(static_cast<sf::Uint32>(m_nodes.size() - 1u), start, end - start, visitor, fraction);
+		}
+		/*!
+        \brief Calls visitor for each object whose AABB lies within maxDistance of the point.
+        Nodes are visited best first, nearest to the point first, and max distance is read
+        before each node and object is tested, so a visitor searching for the nearest objects
+        may lower it as they are found to skip the rest of the tree
+        */
+		template <typename T>
+		void visitNearby(const sf::Vector2f& point, T visitor, const float& maxDistance) const
+		{
+			if(m_nodes.empty()) return;
+
+			//nodes waiting to be searched, nearest first
+			using Entry = std::pair<float, sf::Uint32>;
+			SmallHeap<Entry, 64u, std::greater<Entry>> queue; //only allocates for very deep searches
+			const Node& root = m_nodes.back();
+			queue.push(std::make_pair(boxDistance(point, root.left, root.top, root.right, root.bottom), static_cast<sf::Uint32>(m_nodes.size() - 1u)));
+			while(!queue.empty() && queue.top().first <= maxDistance)
+			{
+				const Node& node = m_nodes[queue.top().second];
+				queue.pop();
+				if(node.leaf)
+				{
+					m_objects.visitNearby(node.first, node.count, point, visitor, maxDistance);
+					continue;
+				}
+
+				for(auto i = node.first; i < node.first + node.count; ++i)
+				{
+					const Node& child = m_nodes[i];
+					const float distance = boxDistance(point, child.left, child.top, child.right, child.bottom);
+					if(distance <= maxDistance) queue.push(std::make_pair(distance, i));
+				}
+			}
+		}
+
+	private:
+		struct Node final
+		{
+			float left, top, right, bottom;
+			sf::Uint32 first; //index of the first child node, or first object if a leaf
+			sf::Uint32 count;
+			bool leaf;
+		};
+		std::vector<Node> m_nodes; //each level follows the one below it, so the root is last
+		ObjectList m_objects; //in leaf order
+		std::vector<const MapObject*> m_sortedObjects; //sorted by address for contains()
+		static const std::size_t maxEntries = 16u; //number of children or objects packed into each node
+
+		template <typename T>
+		void visitNode(sf::Uint32 index, sf::Uint16 depth, const sf::FloatRect& bounds, T& visitor, Query query, SpatialQueryStats* stats) const
+		{
+			const Node& node = m_nodes[index];
+			if(node.left >= bounds.left + bounds.width || node.right <= bounds.left
+				|| node.top >= bounds.top + bounds.height || node.bottom <= bounds.top) return;
+
+			if(stats)
+			{
+				stats->nodesVisited++;
+				stats->maxDepth = std::max(stats->maxDepth, depth);
+				if(node.leaf) stats->objectsTested += node.count;
+			}
+
+			if(node.leaf)
+			{
+				m_objects.visit(node.first, node.count, bounds, visitor, query);
+			}
+			else
+			{
+				for(auto i = node.first; i < node.first + node.count; ++i)
+					visitNode(i, static_cast<sf::Uint16>(depth + 1u), bounds, visitor, query, stats);
+			}
+		}
+
+		template <typename T>
+		void visitRayNode(sf::Uint32 index, const sf::Vector2f& start, const sf::Vector2f& direction, T& visitor, const float& fraction) const
+		{
+			const Node& node = m_nodes[index];
+			if(rayEntry(start, direction, node.left, node.top, node.right, node.bottom) >= fraction) return;
+
+			if(node.leaf)
+			{
+				m_objects.visitRay(node.first, node.count, start, direction, visitor, fraction);
+				return;
+			}
+
+			//visit the children in the order the ray enters them
+			std::array<std::pair<float, sf::Uint32>, maxEntries> children;
+			std::size_t childCount = 0u;
+			for(auto i = node.first; i < node.first + node.count; ++i)
+			{
+				const Node& child = m_nodes[i];
+				const float entry = rayEntry(start, direction, child.left, child.top, child.right, child.bottom);
+				if(entry < fraction) children[childCount++] = std::make_pair(entry, i);
+			}
+			sortByEntry(children.data(), childCount);
+			for(auto i = 0u; i < childCount; ++i)
+			{
+				if(children[i].first < fraction)
+					visitRayNode(children[i].second, start, direction, visitor, fraction);
+			}
+		}
+
+		void draw(sf::RenderTarget& rt, sf::RenderStates states) const override;
+	};
+}
+
+#endif //STATIC_RTREE_HPP_
@@ -0,0 +1,91 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+Zlib License:
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+#ifndef WORKER_POOL_HPP_
+#define WORKER_POOL_HPP_
+
+#include <tmx/Export.hpp>
+
+#include <SFML/Config.hpp>
+#include <SFML/System/NonCopyable.hpp>
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tmx
+{
+	/*!
+    \brief A set of worker threads which are started when first needed and then kept,
+    waiting for more work, until the pool is destroyed. Used to spread batches of queries
+    over several threads without paying for starting threads on every batch
+    */
+	class TMX_EXPORT_API WorkerPool final : private sf::NonCopyable
+	{
+	public:
+		using Task = std::function<void(sf::Uint32 thread, std::size_t first, std::size_t last)>;
+
+		WorkerPool();
+		~WorkerPool();
+
+		/*!
+        \brief Splits count items into threadCount consecutive runs and calls task(thread,
+        first, last) for each run, returning once they are all done. The first run is done
+        on the calling thread and the others by workers, which are started if the pool has
+        fewer than threadCount - 1. Calls from several threads at once take turns using the
+        workers, so a call may wait for another to finish. If any run throws, the others are
+        still finished before the first exception caught is rethrown
+        */
+		void run(sf::Uint32 threadCount, std::size_t count, const Task& task);
+		/*!
+        \brief Returns the number of worker threads started so far
+        */
+		std::size_t getWorkerCount() const;
+
+	private:
+		std::vector<std::thread> m_workers;
+		std::mutex m_runMutex; //held for the whole of run(), so only one batch uses the workers at a time
+		mutable std::mutex m_mutex; //guards the members below
+		std::condition_variable m_startCondition;
+		std::condition_variable m_doneCondition;
+		const Task* m_task;
+		std::size_t m_count;
+		sf::Uint32 m_threadCount;
+		sf::Uint32 m_pending; //workers yet to finish the current batch
+		std::exception_ptr m_error; //first exception thrown by a worker in the current batch
+		sf::Uint64 m_batch; //incremented for each batch so workers can tell when there is more work
+		bool m_stop;
+
+		void work(sf::Uint32 thread, sf::Uint64 batch);
+	};
+}
+
+#endif //WORKER_POOL_HPP_
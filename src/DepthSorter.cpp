@@ -0,0 +1,113 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+Zlib License:
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+#include <tmx/DepthSorter.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+using namespace tmx;
+
+namespace
+{
+	const sf::Uint32 REMOVED = std::numeric_limits<sf::Uint32>::max();
+}
+
+//public
+DepthSorter::Id DepthSorter::add(const sf::Drawable& drawable, float depth)
+{
+	Id id;
+	if(!m_freeIds.empty())
+	{
+		id = m_freeIds.back();
+		m_freeIds.pop_back();
+	}
+	else
+	{
+		id = static_cast<Id>(m_positions.size());
+		m_positions.push_back(REMOVED);
+	}
+
+	Entry entry;
+	entry.depth = depth;
+	entry.id = id;
+	entry.drawable = &drawable;
+	m_entries.push_back(entry);
+	m_positions[id] = static_cast<sf::Uint32>(m_entries.size() - 1u);
+	restoreOrder(m_positions[id]);
+
+	return id;
+}
+
+void DepthSorter::setDepth(Id id, float depth)
+{
+	assert(id < m_positions.size() && m_positions[id] != REMOVED);
+	m_entries[m_positions[id]].depth = depth;
+	restoreOrder(m_positions[id]);
+}
+
+void DepthSorter::remove(Id id)
+{
+	assert(id < m_positions.size() && m_positions[id] != REMOVED);
+
+	//shuffle the following entries down to keep them in order
+	const auto position = m_positions[id];
+	m_entries.erase(m_entries.begin() + position);
+	for(auto i = position; i < m_entries.size(); ++i)
+		m_positions[m_entries[i].id] = i;
+
+	m_positions[id] = REMOVED;
+	m_freeIds.push_back(id);
+}
+
+void DepthSorter::clear()
+{
+	m_entries.clear();
+	m_positions.clear();
+	m_freeIds.clear();
+}
+
+//private
+void DepthSorter::restoreOrder(sf::Uint32 position)
+{
+	while(position > 0u && m_entries[position - 1u].depth > m_entries[position].depth)
+	{
+		std::swap(m_entries[position - 1u], m_entries[position]);
+		m_positions[m_entries[position].id] = position;
+		position--;
+	}
+
+	while(position + 1u < m_entries.size() && m_entries[position + 1u].depth < m_entries[position].depth)
+	{
+		std::swap(m_entries[position + 1u], m_entries[position]);
+		m_positions[m_entries[position].id] = position;
+		position++;
+	}
+	m_positions[m_entries[position].id] = position;
+}
@@ -0,0 +1,367 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+Zlib License:
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+#include <tmx/MapGenerator.hpp>
+#include <tmx/MapLoader.hpp>
+#include <tmx/Log.hpp>
+
+#include <SFML/System/Clock.hpp>
+
+#include "miniz.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+using namespace tmx;
+
+namespace
+{
+	const std::string base64Chars =
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+		"abcdefghijklmnopqrstuvwxyz"
+		"0123456789+/";
+
+	std::string base64Encode(const std::vector<unsigned char>& bytes)
+	{
+		std::string result;
+		result.reserve(((bytes.size() + 2) / 3) * 4);
+
+		for(auto i = 0u; i < bytes.size(); i += 3)
+		{
+			sf::Uint32 triple = bytes[i] << 16;
+			if(i + 1 < bytes.size()) triple |= bytes[i + 1] << 8;
+			if(i + 2 < bytes.size()) triple |= bytes[i + 2];
+
+			result += base64Chars[(triple >> 18) & 0x3f];
+			result += base64Chars[(triple >> 12) & 0x3f];
+			result += (i + 1 < bytes.size()) ? base64Chars[(triple >> 6) & 0x3f] : '=';
+			result += (i + 2 < bytes.size()) ? base64Chars[triple & 0x3f] : '=';
+		}
+		return result;
+	}
+
+	//compresses with a zlib wrapper, or raw deflate if windowBits is negative
+	bool deflateBytes(const std::vector<unsigned char>& source, std::vector<unsigned char>& dest, int windowBits)
+	{
+		z_stream stream;
+		std::memset(&stream, 0, sizeof(stream));
+		if(deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, windowBits, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+		{
+			return false;
+		}
+
+		const auto offset = dest.size();
+		dest.resize(offset + compressBound(static_cast<mz_ulong>(source.size())));
+		stream.next_in = source.data();
+		stream.avail_in = static_cast<unsigned int>(source.size());
+		stream.next_out = dest.data() + offset;
+		stream.avail_out = static_cast<unsigned int>(dest.size() - offset);
+
+		const int result = deflate(&stream, Z_FINISH);
+		dest.resize(offset + stream.total_out);
+		deflateEnd(&stream);
+		return result == Z_STREAM_END;
+	}
+
+	void appendUint32(std::vector<unsigned char>& dest, sf::Uint32 value)
+	{
+		for(auto i = 0u; i < 4u; ++i)
+			dest.push_back(static_cast<unsigned char>(value >> (i * 8u)));
+	}
+
+	std::string encodeLayer(const std::vector<sf::Uint32>& gids, sf::Uint32 width, MapGenerator::Encoding encoding)
+	{
+		std::stringstream ss;
+		switch(encoding)
+		{
+		case MapGenerator::Encoding::Xml:
+			ss << "  <data>\n";
+			for(auto gid : gids) ss << "   <tile gid=\"" << gid << "\"/>\n";
+			ss << "  </data>\n";
+			return ss.str();
+		case MapGenerator::Encoding::Csv:
+			ss << "  <data encoding=\"csv\">\n";
+			for(auto i = 0u; i < gids.size(); ++i)
+			{
+				ss << gids[i];
+				if(i + 1 < gids.size()) ss << ",";
+				if((i + 1) % width == 0) ss << "\n";
+			}
+			ss << "  </data>\n";
+			return ss.str();
+		default: break;
+		}
+
+		//binary encodings store each gid as 4 little endian bytes
+		std::vector<unsigned char> bytes;
+		bytes.reserve(gids.size() * 4u);
+		for(auto gid : gids) appendUint32(bytes, gid);
+
+		std::vector<unsigned char> output;
+		std::string compression;
+		if(encoding == MapGenerator::Encoding::Zlib)
+		{
+			compression = " compression=\"zlib\"";
+			if(!deflateBytes(bytes, output, MZ_DEFAULT_WINDOW_BITS))
+			{
+				LOG("Failed compressing generated layer data", Logger::Type::Error);
+			}
+		}
+		else if(encoding == MapGenerator::Encoding::Gzip)
+		{
+			//minimal gzip header: magic, deflate method, no flags, no time, unknown OS
+			compression = " compression=\"gzip\"";
+			const unsigned char header[] = { 0x1f, 0x8b, 8u, 0u, 0u, 0u, 0u, 0u, 0u, 0xff };
+			output.assign(std::begin(header), std::end(header));
+			if(!deflateBytes(bytes, output, -MZ_DEFAULT_WINDOW_BITS))
+			{
+				LOG("Failed compressing generated layer data", Logger::Type::Error);
+			}
+			appendUint32(output, static_cast<sf::Uint32>(mz_crc32(MZ_CRC32_INIT, bytes.data(), bytes.size())));
+			appendUint32(output, static_cast<sf::Uint32>(bytes.size()));
+		}
+		else
+		{
+			output.swap(bytes);
+		}
+
+		//the loader expects the encoded string without any line breaks
+		ss << "  <data encoding=\"base64\"" << compression << ">\n   " << base64Encode(output) << "\n  </data>\n";
+		return ss.str();
+	}
+}
+
+MapGenerator::Settings::Settings()
+	: mapSize			(100u, 100u),
+	tileSize			(32u, 32u),
+	layerCount			(2u),
+	encoding			(Encoding::Zlib),
+	sparsity			(0.f),
+	tilesetCount		(1u),
+	tilesetImage		("tmw_desert_spacing.png"),
+	tilesetImageSize	(265u, 199u),
+	tilesetSpacing		(1u),
+	tilesetMargin		(1u),
+	objectLayerCount	(1u),
+	objectCount			(100u),
+	seed				(0u)
+{
+	shapeMix[Rectangle] = 1.f;
+	shapeMix[Ellipse] = 1.f;
+	shapeMix[Polygon] = 1.f;
+	shapeMix[Polyline] = 1.f;
+}
+
+MapGenerator::MapGenerator(const Settings& settings)
+	: m_settings(settings)
+{
+	assert(settings.mapSize.x > 0 && settings.mapSize.y > 0);
+	assert(settings.tileSize.x > 0 && settings.tileSize.y > 0);
+	assert(settings.tilesetCount > 0);
+}
+
+//public
+std::string MapGenerator::toString() const
+{
+	const auto& s = m_settings;
+	std::mt19937 rng(s.seed);
+	std::uniform_real_distribution<float> chance(0.f, 1.f);
+
+	//match the way the loader slices tile set images
+	const sf::Uint32 columns = (s.tilesetImageSize.x - 2u * s.tilesetMargin + s.tilesetSpacing) / (s.tileSize.x + s.tilesetSpacing);
+	const sf::Uint32 rows = (s.tilesetImageSize.y - 2u * s.tilesetMargin + s.tilesetSpacing) / (s.tileSize.y + s.tilesetSpacing);
+	const sf::Uint32 tilesPerSet = std::max(1u, columns * rows);
+	const sf::Uint32 tileCount = tilesPerSet * s.tilesetCount;
+	std::uniform_int_distribution<sf::Uint32> gidDist(1u, tileCount);
+
+	std::stringstream ss;
+	ss << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+	ss << "<map version=\"1.0\" orientation=\"orthogonal\" renderorder=\"right-down\" width=\"" << s.mapSize.x
+		<< "\" height=\"" << s.mapSize.y << "\" tilewidth=\"" << s.tileSize.x << "\" tileheight=\"" << s.tileSize.y << "\">\n";
+
+	for(auto i = 0u; i < s.tilesetCount; ++i)
+	{
+		ss << " <tileset firstgid=\"" << (i * tilesPerSet + 1u) << "\" name=\"synthetic" << i
+			<< "\" tilewidth=\"" << s.tileSize.x << "\" tileheight=\"" << s.tileSize.y
+			<< "\" spacing=\"" << s.tilesetSpacing << "\" margin=\"" << s.tilesetMargin << "\">\n";
+		ss << "  <image source=\"" << s.tilesetImage << "\" width=\"" << s.tilesetImageSize.x
+			<< "\" height=\"" << s.tilesetImageSize.y << "\"/>\n";
+		ss << " </tileset>\n";
+	}
+
+	std::vector<sf::Uint32> gids(s.mapSize.x * s.mapSize.y);
+	for(auto i = 0u; i < s.layerCount; ++i)
+	{
+		for(auto& gid : gids)
+			gid = (chance(rng) < s.sparsity) ? 0u : gidDist(rng);
+
+		ss << " <layer name=\"Layer" << i << "\" width=\"" << s.mapSize.x << "\" height=\"" << s.mapSize.y << "\">\n";
+		ss << encodeLayer(gids, s.mapSize.x, s.encoding);
+		ss << " </layer>\n";
+	}
+
+	if(s.objectLayerCount > 0u)
+	{
+		std::vector<MapObjectShape> shapes;
+		std::vector<float> weights;
+		for(const auto& shape : s.shapeMix)
+		{
+			if(shape.second <= 0.f) continue;
+			shapes.push_back(shape.first);
+			weights.push_back(shape.second);
+		}
+		if(shapes.empty())
+		{
+			shapes.push_back(Rectangle);
+			weights.push_back(1.f);
+		}
+		std::discrete_distribution<std::size_t> shapeDist(weights.begin(), weights.end());
+
+		const sf::Vector2f mapSize(static_cast<float>(s.mapSize.x * s.tileSize.x), static_cast<float>(s.mapSize.y * s.tileSize.y));
+		const sf::Vector2f tileSize(static_cast<float>(s.tileSize.x), static_cast<float>(s.tileSize.y));
+		//tile objects are drawn above their position so start a tile down, clamped for maps a tile tall
+		std::uniform_real_distribution<float> xDist(0.f, std::max(0.f, mapSize.x - tileSize.x));
+		std::uniform_real_distribution<float> yDist(tileSize.y, std::max(tileSize.y, mapSize.y - tileSize.y));
+		std::uniform_real_distribution<float> sizeDist(0.5f, 2.f); //in tiles
+
+		sf::Uint32 objectId = 1u;
+		for(auto i = 0u; i < s.objectLayerCount; ++i)
+		{
+			const sf::Uint32 count = s.objectCount / s.objectLayerCount + ((i < s.objectCount % s.objectLayerCount) ? 1u : 0u);
+			ss << " <objectgroup name=\"Objects" << i << "\">\n";
+
+			for(auto j = 0u; j < count; ++j)
+			{
+				const MapObjectShape shape = shapes[shapeDist(rng)];
+				const float x = xDist(rng);
+				const float y = yDist(rng);
+				const sf::Vector2f size(tileSize.x * sizeDist(rng), tileSize.y * sizeDist(rng));
+
+				ss << "  <object id=\"" << objectId++ << "\" x=\"" << x << "\" y=\"" << y << "\"";
+				switch(shape)
+				{
+				default:
+				case Rectangle:
+					ss << " width=\"" << size.x << "\" height=\"" << size.y << "\"/>\n";
+					break;
+				case Circle:
+					ss << " width=\"" << size.x << "\" height=\"" << size.x << "\">\n   <ellipse/>\n  </object>\n";
+					break;
+				case Ellipse:
+					ss << " width=\"" << size.x << "\" height=\"" << size.y << "\">\n   <ellipse/>\n  </object>\n";
+					break;
+				case Polygon:
+				case Polyline:
+					{
+						//points around an ellipse with some jitter, so polygons are simple but not always convex
+						const sf::Uint32 pointCount = 3u + rng() % 6u;
+						const float step = 6.283185f / pointCount;
+						ss << ">\n   <" << ((shape == Polygon) ? "polygon" : "polyline") << " points=\"";
+						for(auto k = 0u; k < pointCount; ++k)
+						{
+							const float radius = 0.5f + chance(rng) * 0.5f;
+							ss << (std::cos(step * k) * size.x * radius) << "," << (std::sin(step * k) * size.y * radius);
+							if(k + 1 < pointCount) ss << " ";
+						}
+						ss << "\"/>\n  </object>\n";
+					}
+					break;
+				case Tile:
+					ss << " gid=\"" << gidDist(rng) << "\"/>\n";
+					break;
+				}
+			}
+			ss << " </objectgroup>\n";
+		}
+	}
+
+	ss << "</map>\n";
+	return ss.str();
+}
+
+bool MapGenerator::saveToFile(const std::string& path) const
+{
+	std::ofstream file(path);
+	if(!file.good())
+	{
+		LOG("Failed to open " + path + " for writing", Logger::Type::Error);
+		return false;
+	}
+	file << toString();
+	return file.good();
+}
+
+MapGenerator::Source MapGenerator::parseSource(const std::string& name)
+{
+	Source source;
+	char separator = 0;
+	std::stringstream ss(name);
+	if(name.find(".tmx") == std::string::npos
+		&& ss >> source.mapSize.x >> separator >> source.mapSize.y
+		&& separator == 'x')
+	{
+		source.generated = true;
+		source.directory = "maps/";
+		return source;
+	}
+
+	source.mapSize = sf::Vector2u();
+	const auto split = name.find_last_of("/\\");
+	source.directory = (split == std::string::npos) ? "./" : name.substr(0, split + 1);
+	source.file = (split == std::string::npos) ? name : name.substr(split + 1);
+	return source;
+}
+
+bool MapGenerator::load(MapLoader& loader, const Source& source, Settings settings, sf::Time* loadTime)
+{
+	sf::Clock clock;
+	bool loaded = false;
+	if(source.generated)
+	{
+		if(source.mapSize.x == 0u || source.mapSize.y == 0u)
+		{
+			LOG("Cannot generate a map with no tiles", Logger::Type::Error);
+			return false;
+		}
+
+		settings.mapSize = source.mapSize;
+		const std::string xml = MapGenerator(settings).toString();
+		clock.restart(); //only time the loading, not the generating
+		loaded = loader.loadFromMemory(xml);
+	}
+	else
+	{
+		loaded = loader.load(source.file);
+	}
+
+	if(loadTime) *loadTime = clock.getElapsedTime();
+	return loaded;
+}
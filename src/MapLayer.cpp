@@ -27,18 +27,44 @@ it freely, subject to the following restrictions:
 *********************************************************************/
 
 #include <tmx/MapLayer.hpp>
+#include <tmx/Log.hpp>
+
+#include <SFML/Graphics/RenderTexture.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <cassert>
 
 using namespace tmx;
+
+namespace
+{
+	//grows rect to cover the area between min and max, returns true if it changed
+	bool expandRect(sf::FloatRect& rect, const sf::Vector2f& min, const sf::Vector2f& max)
+	{
+		const float right = std::max(rect.left + rect.width, max.x);
+		const float bottom = std::max(rect.top + rect.height, max.y);
+		const sf::FloatRect expanded(std::min(rect.left, min.x), std::min(rect.top, min.y), 0.f, 0.f);
+		if(expanded.left == rect.left && expanded.top == rect.top
+			&& right == rect.left + rect.width && bottom == rect.top + rect.height)
+		{
+			return false;
+		}
+		rect.left = expanded.left;
+		rect.top = expanded.top;
+		rect.width = right - rect.left;
+		rect.height = bottom - rect.top;
+		return true;
+	}
+}
 ///------TileQuad-----///
-TileQuad::TileQuad(sf::Uint16 i0, sf::Uint16 i1, sf::Uint16 i2, sf::Uint16 i3)
-    : m_colour      (sf::Color::White),
-    m_parentSet	    (nullptr),
+TileQuad::TileQuad(sf::Uint32 firstIndex)
+	: m_firstIndex	(firstIndex),
+	m_colour		(sf::Color::White),
+	m_parentSet		(nullptr),
 	m_patchIndex	(-1)
 {
-	m_indices[0] = i0;
-	m_indices[1] = i1;
-	m_indices[2] = i2;
-	m_indices[3] = i3;
+
 }
 
 void TileQuad::move(const sf::Vector2f& distance)
@@ -70,111 +96,480 @@ void TileQuad::setDirty()
 
 ///------LayerSet-----///
 
+const sf::Uint8 LayerSet::maxLodLevels;
+
 //public
 LayerSet::LayerSet(const sf::Texture& texture, sf::Uint8 patchSize, const sf::Vector2u& mapSize, const sf::Vector2u tileSize)
 	: m_texture	(texture),
-	m_patchSize	(patchSize),
+	m_patchTiles((patchSize > 0u) ? sf::Vector2u(patchSize, patchSize) : sf::Vector2u(std::max(1u, mapSize.x), std::max(1u, mapSize.y))),
 	m_mapSize	(mapSize),
+	m_patchCount((mapSize.x + m_patchTiles.x - 1u) / m_patchTiles.x, (mapSize.y + m_patchTiles.y - 1u) / m_patchTiles.y),
 	m_tileSize	(tileSize),
-	m_patchCount(static_cast<sf::Uint32>(std::ceil(static_cast<float>(mapSize.x) / patchSize)), static_cast<sf::Uint32>(std::ceil(static_cast<float>(mapSize.y) / patchSize))),
-	m_visible	(true)
+	m_updatedQuads(0u),
+	m_filledPatchCount(0u),
+	m_lastPatchIndex(-1),
+	m_animationFrames(nullptr),
+	m_bandHeight(0.f),
+	m_visible	(true),
+	m_minTexelDensity(1.f),
+	m_currentLod(0u)
 {
-	m_patches.resize(m_patchCount.x * m_patchCount.y);
+	m_patches.resize(std::max(1u, m_patchCount.x * m_patchCount.y));
+	m_patchBounds.resize(m_patches.size());
 }
 
 TileQuad* LayerSet::addTile(sf::Vertex vt0, sf::Vertex vt1, sf::Vertex vt2, sf::Vertex vt3, sf::Uint16 x, sf::Uint16 y)
 {
-	sf::Int32 patchX = static_cast<sf::Int32>(std::ceil(x / m_patchSize));
-	sf::Int32 patchY = static_cast<sf::Int32>(std::ceil(y / m_patchSize));
-	sf::Int32 patchIndex = m_patchCount.x * patchY + patchX;
-
-	m_patches[patchIndex].push_back(vt0);
-	m_patches[patchIndex].push_back(vt1);
-	m_patches[patchIndex].push_back(vt2);
-	m_patches[patchIndex].push_back(vt3);
+	const sf::Vertex vertices[] = { vt0, vt1, vt2, vt3 };
+	sf::Int32 patchIndex = addVertices(vertices, x, y);
 
-	sf::Uint16 i = m_patches[patchIndex].size() - 4u;
-	m_quads.emplace_back(TileQuad::Ptr(new TileQuad(i, i + 1, i + 2, i + 3)));
+	m_quads.emplace_back(TileQuad::Ptr(new TileQuad(static_cast<sf::Uint32>(m_patches[patchIndex].size() - 4u))));
 	m_quads.back()->m_parentSet = this;
 	m_quads.back()->m_patchIndex = patchIndex;
 
-	updateAABB(vt0.position, vt2.position);
-
 	return m_quads.back().get();
 }
 
-void LayerSet::cull(const sf::FloatRect& bounds)
+void LayerSet::addTile(const sf::Vertex* vertices, sf::Uint16 x, sf::Uint16 y)
+{
+	addVertices(vertices, x, y);
+}
+
+void LayerSet::animateLastTile(const std::vector<TileAnimationFrame>& frames, sf::Uint32 animation, const std::array<sf::Uint8, 4u>& corners)
+{
+	assert(m_lastPatchIndex > -1);
+	assert(animation < frames.size());
+
+	m_animationFrames = &frames;
+	if(m_animatedTiles.empty()) m_animatedTiles.resize(m_patches.size());
+
+	AnimatedTile tile;
+	tile.firstIndex = static_cast<sf::Uint32>(m_patches[m_lastPatchIndex].size() - 4u);
+	tile.animation = animation;
+	tile.frame = std::numeric_limits<sf::Uint32>::max(); //make sure the first frame is written
+	tile.corners = corners;
+	m_animatedTiles[m_lastPatchIndex].push_back(tile);
+}
+
+void LayerSet::cull(const sf::FloatRect& bounds, const sf::IntRect& tileBounds, float scale)
 {
 	m_visible = m_boundingBox.intersects(bounds);
+	m_visiblePatches.clear();
+
+	if(m_visible)
+	{
+		//find the patches covering the visible part of the grid. Negative values are clamped
+		//to 0 anyway, so integer division rounding towards 0 doesn't matter
+		const int startX = std::max(0, tileBounds.left / static_cast<int>(m_patchTiles.x));
+		const int startY = std::max(0, tileBounds.top / static_cast<int>(m_patchTiles.y));
+		const int endX = std::min(static_cast<int>(m_patchCount.x) - 1, (tileBounds.left + tileBounds.width) / static_cast<int>(m_patchTiles.x));
+		const int endY = std::min(static_cast<int>(m_patchCount.y) - 1, (tileBounds.top + tileBounds.height) / static_cast<int>(m_patchTiles.y));
+
+		//on non-orthogonal maps the grid area is larger than the view, so test each patch
+		for(auto y = startY; y <= endY; ++y)
+		{
+			for(auto x = startX; x <= endX; ++x)
+			{
+				const auto index = y * m_patchCount.x + x;
+				if(!m_patches[index].empty() && m_patchBounds[index].intersects(bounds))
+					m_visiblePatches.push_back(index);
+			}
+		}
 
-	//update visible patch indices
-	m_visiblePatchStart.x = static_cast<int>(std::floor((bounds.left / m_tileSize.x) / m_patchSize));
-	m_visiblePatchStart.y = static_cast<int>(std::floor((bounds.top / m_tileSize.y) / m_patchSize));
-	if(m_visiblePatchStart.x < 0) m_visiblePatchStart.x = 0;
-	if(m_visiblePatchStart.y < 0) m_visiblePatchStart.y = 0;
+		//patches grown by moved quads may reach into the view from outside the grid area
+		bool added = false;
+		for(auto index : m_grownPatches)
+		{
+			const int x = static_cast<int>(index % m_patchCount.x);
+			const int y = static_cast<int>(index / m_patchCount.x);
+			if(x >= startX && x <= endX && y >= startY && y <= endY) continue;
+			if(m_patchBounds[index].intersects(bounds))
+			{
+				m_visiblePatches.push_back(index);
+				added = true;
+			}
+		}
+		if(added) std::sort(m_visiblePatches.begin(), m_visiblePatches.end());
+	}
 
-	m_visiblePatchEnd.x = static_cast<int>(std::ceil((bounds.width / m_tileSize.x) / m_patchSize));
-	m_visiblePatchEnd.y = static_cast<int>(std::ceil((bounds.height / m_tileSize.y) / m_patchSize));
-	if(m_visiblePatchEnd.x > static_cast<int>(m_patchCount.x)) m_visiblePatchEnd.x = m_patchCount.x;
-	if(m_visiblePatchEnd.y > static_cast<int>(m_patchCount.y)) m_visiblePatchEnd.y = m_patchCount.y;
+	//pick the coarsest level which still provides enough texels per screen pixel
+	m_currentLod = 0u;
+	while(m_currentLod < m_lodLevels.size()
+		&& static_cast<float>(2u << m_currentLod) * scale * m_minTexelDensity <= 1.f)
+	{
+		m_currentLod++;
+	}
 
-	m_visiblePatchEnd += m_visiblePatchStart;
+	if(m_currentLod > 0u)
+	{
+		const auto& lod = m_lodLevels[m_currentLod - 1u];
+		m_visibleChunkStart.x = std::max(0, static_cast<int>(std::floor((bounds.left - m_lodOrigin.x) / lod.chunkSize.x)));
+		m_visibleChunkStart.y = std::max(0, static_cast<int>(std::floor((bounds.top - m_lodOrigin.y) / lod.chunkSize.y)));
+		m_visibleChunkEnd.x = std::min(static_cast<int>(lod.chunkCount.x) - 1, static_cast<int>(std::floor((bounds.left + bounds.width - m_lodOrigin.x) / lod.chunkSize.x)));
+		m_visibleChunkEnd.y = std::min(static_cast<int>(lod.chunkCount.y) - 1, static_cast<int>(std::floor((bounds.top + bounds.height - m_lodOrigin.y) / lod.chunkSize.y)));
+	}
 }
 
-//private
-void LayerSet::draw(sf::RenderTarget& rt, sf::RenderStates states) const
+void LayerSet::buildLod(sf::Uint8 levels, float minTexelDensity)
 {
-	//std::vector<sf::Int32> dirtyPatches; //TODO prevent patches being duplicated
+	m_lodLevels.clear();
+	m_currentLod = 0u;
+	m_minTexelDensity = minTexelDensity;
+	levels = std::min(levels, maxLodLevels);
+	if(levels == 0u || m_filledPatchCount == 0u) return;
+
+	//find the bounds of all the patches, as tiles larger than the grid may overlap neighbours
+	sf::Vector2f min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+	sf::Vector2f max(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
+	for(auto i = 0u; i < m_patches.size(); ++i)
+	{
+		if(m_patches[i].empty()) continue;
+
+		const auto& bounds = m_patchBounds[i];
+		min.x = std::min(min.x, bounds.left);
+		min.y = std::min(min.y, bounds.top);
+		max.x = std::max(max.x, bounds.left + bounds.width);
+		max.y = std::max(max.y, bounds.top + bounds.height);
+	}
+
+	//each chunk texture has the same resolution as a full detail patch
+	const sf::Vector2u chunkPixels(m_patchTiles.x * m_tileSize.x, m_patchTiles.y * m_tileSize.y);
+	if(std::max(chunkPixels.x, chunkPixels.y) * 2u > sf::Texture::getMaximumSize())
+	{
+		LOG("Patch size too large to build level of detail textures.", Logger::Type::Warning);
+		return;
+	}
+
+	sf::RenderTexture fullDetail, halfDetail;
+	if(!fullDetail.create(chunkPixels.x * 2u, chunkPixels.y * 2u)
+		|| !halfDetail.create(chunkPixels.x, chunkPixels.y))
+	{
+		LOG("Failed to create render textures for level of detail.", Logger::Type::Error);
+		return;
+	}
+	fullDetail.setSmooth(true);
+	halfDetail.setSmooth(true);
+	m_lodOrigin = min;
+
+	sf::RenderStates states;
+	states.texture = &m_texture;
+	for(auto level = 1u; level <= levels; ++level)
+	{
+		LodLevel lod;
+		lod.chunkSize.x = static_cast<float>(chunkPixels.x << level);
+		lod.chunkSize.y = static_cast<float>(chunkPixels.y << level);
+		lod.chunkCount.x = std::max(1u, static_cast<sf::Uint32>(std::ceil((max.x - min.x) / lod.chunkSize.x)));
+		lod.chunkCount.y = std::max(1u, static_cast<sf::Uint32>(std::ceil((max.y - min.y) / lod.chunkSize.y)));
+		lod.chunks.resize(lod.chunkCount.x * lod.chunkCount.y);
+
+		for(auto cy = 0u; cy < lod.chunkCount.y; ++cy)
+		{
+			for(auto cx = 0u; cx < lod.chunkCount.x; ++cx)
+			{
+				const sf::FloatRect area(min.x + cx * lod.chunkSize.x, min.y + cy * lod.chunkSize.y, lod.chunkSize.x, lod.chunkSize.y);
+				bool empty = true;
+				halfDetail.clear(sf::Color::Transparent);
+
+				if(level == 1u)
+				{
+					//render the full detail tiles then halve them
+					fullDetail.setView(sf::View(area));
+					fullDetail.clear(sf::Color::Transparent);
+					for(auto x = 0u; x < m_patchCount.x; ++x)
+					{
+						for(auto y = 0u; y < m_patchCount.y; ++y)
+						{
+							const auto index = y * m_patchCount.x + x;
+							if(!m_patches[index].empty() && m_patchBounds[index].intersects(area))
+							{
+								fullDetail.draw(m_patches[index].data(), static_cast<unsigned>(m_patches[index].size()), sf::Quads, states);
+								empty = false;
+							}
+						}
+					}
+					if(empty) continue;
+					fullDetail.display();
+
+					sf::Sprite sprite(fullDetail.getTexture());
+					sprite.setScale(0.5f, 0.5f);
+					halfDetail.draw(sprite);
+				}
+				else
+				{
+					//halve the four chunks of the previous level
+					const auto& previous = m_lodLevels.back();
+					for(auto y = 0u; y < 2u; ++y)
+					{
+						for(auto x = 0u; x < 2u; ++x)
+						{
+							const auto px = cx * 2u + x;
+							const auto py = cy * 2u + y;
+							if(px >= previous.chunkCount.x || py >= previous.chunkCount.y) continue;
+
+							const auto& child = previous.chunks[py * previous.chunkCount.x + px];
+							if(!child.texture) continue;
+
+							sf::Sprite sprite(*child.texture);
+							sprite.setScale(0.5f, 0.5f);
+							sprite.setPosition(static_cast<float>(x * chunkPixels.x) / 2.f, static_cast<float>(y * chunkPixels.y) / 2.f);
+							halfDetail.draw(sprite);
+							empty = false;
+						}
+					}
+					if(empty) continue;
+				}
+				halfDetail.display();
+
+				auto& chunk = lod.chunks[cy * lod.chunkCount.x + cx];
+				chunk.texture = std::make_shared<sf::Texture>(halfDetail.getTexture());
+				chunk.texture->setSmooth(true);
+
+				const sf::Vector2f texSize(static_cast<float>(chunkPixels.x), static_cast<float>(chunkPixels.y));
+				chunk.vertices[0] = sf::Vertex(sf::Vector2f(area.left, area.top), sf::Vector2f());
+				chunk.vertices[1] = sf::Vertex(sf::Vector2f(area.left + area.width, area.top), sf::Vector2f(texSize.x, 0.f));
+				chunk.vertices[2] = sf::Vertex(sf::Vector2f(area.left + area.width, area.top + area.height), texSize);
+				chunk.vertices[3] = sf::Vertex(sf::Vector2f(area.left, area.top + area.height), sf::Vector2f(0.f, texSize.y));
+			}
+		}
+
+		const bool lastLevel = (lod.chunkCount.x == 1u && lod.chunkCount.y == 1u);
+		m_lodLevels.push_back(std::move(lod));
+		if(lastLevel) break; //no point halving any further
+	}
+	LOG("Built " + std::to_string(m_lodLevels.size()) + " levels of detail", Logger::Type::Info);
+}
+
+bool LayerSet::updateQuads() const
+{
+	bool grown = false;
 	for(const auto& q : m_dirtyQuads)
 	{
-		for(const auto& p : q->m_indices)
+		auto& patch = m_patches[q->m_patchIndex];
+		sf::Vector2f min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+		sf::Vector2f max(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
+		for(auto p = q->m_firstIndex; p < q->m_firstIndex + 4u; ++p)
 		{
-			m_patches[q->m_patchIndex][p].position += q->m_movement;
-            m_patches[q->m_patchIndex][p].color = q->m_colour;
+			patch[p].position += q->m_movement;
+			patch[p].color = q->m_colour;
+
+			min.x = std::min(min.x, patch[p].position.x);
+			min.y = std::min(min.y, patch[p].position.y);
+			max.x = std::max(max.x, patch[p].position.x);
+			max.y = std::max(max.y, patch[p].position.y);
+		}
+
+		//bounds only ever grow, so a quad moved back and forth keeps its patch drawn over the whole area
+		if(expandRect(m_patchBounds[q->m_patchIndex], min, max))
+		{
+			const sf::Uint32 index = q->m_patchIndex;
+			auto result = std::lower_bound(m_grownPatches.begin(), m_grownPatches.end(), index);
+			if(result == m_grownPatches.end() || *result != index)
+				m_grownPatches.insert(result, index);
+
+			expandRect(m_boundingBox, min, max);
+			grown = true;
 		}
-		//mark AABB as dirty if patch size has changed - TODO this doesn't shrink AABB :/
-		//if(!m_boundingBox.contains(m_patches[q->m_patchIndex][0].position)
-		//	|| !m_boundingBox.contains(m_patches[q->m_patchIndex][0].position))
-		//{
-		//	//we only need to check first and 3rd - not all 4
-		//	dirtyPatches.push_back(q->m_patchIndex);
-		//}
 	}
+	m_updatedQuads += static_cast<sf::Uint32>(m_dirtyQuads.size());
 	m_dirtyQuads.clear();
+	return grown;
+}
+
+//private
+void LayerSet::prepareDraw() const
+{
+	m_stats = RenderStats::Counters();
+	updateQuads();
+	m_stats.dirtyQuads = m_updatedQuads;
+	m_updatedQuads = 0u;
 
-	//for(auto p : dirtyPatches)
-	//{
-	//	//update AABB
-	//	sf::Vector2f min, max;
-	//	const auto& verts = m_patches[p];
-	//	for(auto i = 0; i < verts.size(); i += 2) //only check extents
-	//	{
-	//		if(verts[i].position.x < min.x) min.x = verts[i].position.x;
-	//		else if(verts[i].position.x > max.x) max.x = verts[i].position.x;
-	//		if(verts[i].position.y < min.y) min.y = verts[i].position.y;
-	//		else if(verts[i].position.y > max.y) max.y = verts[i].position.y;
-	//	}
-
-	//	//TODO this doesn't shrink the AABB!
-	//	if(m_boundingBox.left > min.x) m_boundingBox.left = min.x;
-	//	if(m_boundingBox.top > min.y) m_boundingBox.top = min.y;
-	//	if(std::abs(m_boundingBox.left) + m_boundingBox.width < max.x) m_boundingBox.width = std::fabs(m_boundingBox.left) + max.x;
-	//	if(std::abs(m_boundingBox.top) + m_boundingBox.height < max.y) m_boundingBox.width = std::fabs(m_boundingBox.top) + max.y;
-	//}
+	m_stats.culledPatches = m_filledPatchCount;
 
+	//animated tiles are only updated in patches which are about to be drawn
+	if(m_visible && m_currentLod == 0u && !m_animatedTiles.empty())
+	{
+		for(auto index : m_visiblePatches)
+			updateAnimatedTiles(index);
+	}
+}
+
+void LayerSet::draw(sf::RenderTarget& rt, sf::RenderStates states) const
+{
+	prepareDraw();
 	if(!m_visible) return;
 
-	for(auto x = m_visiblePatchStart.x; x <= m_visiblePatchEnd.x; ++x)
+	if(m_currentLod > 0u)
 	{
-		for(auto y = m_visiblePatchStart.y; y <= m_visiblePatchEnd.y; ++y)
+		//the patches are replaced by the level's chunks rather than culled
+		m_stats.culledPatches = 0u;
+		const auto& lod = m_lodLevels[m_currentLod - 1u];
+		for(auto x = m_visibleChunkStart.x; x <= m_visibleChunkEnd.x; ++x)
 		{
-			auto index = y * m_patchCount.x + x;
-			if(index < m_patches.size() && !m_patches[index].empty())
+			for(auto y = m_visibleChunkStart.y; y <= m_visibleChunkEnd.y; ++y)
 			{
-				states.texture = &m_texture;
-				rt.draw(m_patches[index].data(), static_cast<unsigned>(m_patches[index].size()), sf::Quads, states);
+				const auto& chunk = lod.chunks[y * lod.chunkCount.x + x];
+				if(chunk.texture)
+				{
+					states.texture = chunk.texture.get();
+					rt.draw(chunk.vertices.data(), 4u, sf::Quads, states);
+					m_stats.drawCalls++;
+					m_stats.vertices += 4u;
+					m_stats.lodChunks++;
+				}
 			}
 		}
+		return;
+	}
+
+	states.texture = &m_texture;
+	for(auto index : m_visiblePatches)
+	{
+		rt.draw(m_patches[index].data(), static_cast<unsigned>(m_patches[index].size()), sf::Quads, states);
+		m_stats.drawCalls++;
+		m_stats.vertices += static_cast<sf::Uint32>(m_patches[index].size());
+		m_stats.visiblePatches++;
+	}
+	m_stats.culledPatches -= m_stats.visiblePatches;
+}
+
+void LayerSet::buildDepthBands(float bandHeight)
+{
+	assert(bandHeight > 0.f);
+	m_bandHeight = bandHeight;
+	m_patchBands.assign(m_patches.size(), PatchBands());
+
+	//new index of each quad in its patch, used to update TileQuads and animated tiles
+	std::vector<std::vector<sf::Uint32>> newPositions(m_patches.size());
+	std::vector<sf::Int32> bands;
+	std::vector<sf::Uint32> order;
+	std::vector<sf::Vertex> sorted;
+
+	for(auto p = 0u; p < m_patches.size(); ++p)
+	{
+		auto& patch = m_patches[p];
+		if(patch.empty()) continue;
+
+		const auto quadCount = static_cast<sf::Uint32>(patch.size() / 4u);
+		bands.resize(quadCount);
+		order.resize(quadCount);
+		for(auto i = 0u; i < quadCount; ++i)
+		{
+			bands[i] = static_cast<sf::Int32>(std::floor(patch[i * 4u + 2u].position.y / bandHeight));
+			order[i] = i;
+		}
+		//stable so tiles in the same band keep their row order
+		std::stable_sort(order.begin(), order.end(), [&bands](sf::Uint32 a, sf::Uint32 b){ return bands[a] < bands[b]; });
+
+		sorted.clear();
+		newPositions[p].resize(quadCount);
+		for(auto i = 0u; i < quadCount; ++i)
+		{
+			sorted.insert(sorted.end(), patch.begin() + order[i] * 4u, patch.begin() + order[i] * 4u + 4u);
+			newPositions[p][order[i]] = i;
+		}
+		patch.swap(sorted);
+
+		auto& patchBands = m_patchBands[p];
+		patchBands.first = bands[order.front()];
+		const sf::Int32 last = bands[order.back()];
+		patchBands.starts.resize(last - patchBands.first + 2);
+		auto quad = 0u;
+		for(auto band = patchBands.first; band <= last + 1; ++band)
+		{
+			while(quad < quadCount && bands[order[quad]] < band) quad++;
+			patchBands.starts[band - patchBands.first] = quad * 4u;
+		}
+	}
+
+	for(auto& q : m_quads)
+		q->m_firstIndex = newPositions[q->m_patchIndex][q->m_firstIndex / 4u] * 4u;
+
+	for(auto p = 0u; p < m_animatedTiles.size(); ++p)
+	{
+		for(auto& tile : m_animatedTiles[p])
+			tile.firstIndex = newPositions[p][tile.firstIndex / 4u] * 4u;
+	}
+}
+
+bool LayerSet::getVisibleBands(sf::Int32& first, sf::Int32& last) const
+{
+	//sets which can't be drawn a band at a time are drawn whole, which prepares them instead
+	if(m_bandHeight == 0.f || !m_visible || m_currentLod > 0u || m_visiblePatches.empty()) return false;
+
+	prepareDraw();
+
+	first = std::numeric_limits<sf::Int32>::max();
+	last = std::numeric_limits<sf::Int32>::min();
+	for(auto index : m_visiblePatches)
+	{
+		const auto& patchBands = m_patchBands[index];
+		first = std::min(first, patchBands.first);
+		last = std::max(last, patchBands.first + static_cast<sf::Int32>(patchBands.starts.size()) - 2);
+	}
+	m_stats.visiblePatches = static_cast<sf::Uint32>(m_visiblePatches.size());
+	m_stats.culledPatches -= m_stats.visiblePatches;
+	return true;
+}
+
+void LayerSet::drawBand(sf::RenderTarget& rt, sf::RenderStates states, sf::Int32 band) const
+{
+	states.texture = &m_texture;
+	for(auto index : m_visiblePatches)
+	{
+		const auto& patchBands = m_patchBands[index];
+		const sf::Int32 i = band - patchBands.first;
+		if(i < 0 || i + 1 >= static_cast<sf::Int32>(patchBands.starts.size())) continue;
+
+		const auto start = patchBands.starts[i];
+		const auto count = patchBands.starts[i + 1] - start;
+		if(count == 0u) continue;
+
+		rt.draw(&m_patches[index][start], count, sf::Quads, states);
+		m_stats.drawCalls++;
+		m_stats.vertices += count;
+	}
+}
+
+sf::Int32 LayerSet::addVertices(const sf::Vertex* vertices, sf::Uint16 x, sf::Uint16 y)
+{
+	sf::Int32 patchX = x / m_patchTiles.x;
+	sf::Int32 patchY = y / m_patchTiles.y;
+	sf::Int32 patchIndex = m_patchCount.x * patchY + patchX;
+
+	auto& patch = m_patches[patchIndex];
+	auto& patchBounds = m_patchBounds[patchIndex];
+	const sf::Vector2f min = vertices[0].position;
+	const sf::Vector2f max = vertices[2].position;
+	if(patch.empty())
+	{
+		m_filledPatchCount++;
+		patchBounds = sf::FloatRect(min, max - min);
+	}
+	else
+	{
+		expandRect(patchBounds, min, max);
+	}
+	patch.insert(patch.end(), vertices, vertices + 4);
+
+	updateAABB(vertices[0].position, vertices[2].position);
+
+	m_lastPatchIndex = patchIndex;
+	return patchIndex;
+}
+
+void LayerSet::updateAnimatedTiles(sf::Uint32 patchIndex) const
+{
+	auto& patch = m_patches[patchIndex];
+	for(auto& tile : m_animatedTiles[patchIndex])
+	{
+		const auto& frame = (*m_animationFrames)[tile.animation];
+		if(tile.frame == frame.index) continue;
+
+		for(auto i = 0u; i < 4u; ++i)
+			patch[tile.firstIndex + i].texCoords = frame.texCoords[tile.corners[i]];
+
+		tile.frame = frame.index;
+		m_stats.animatedQuads++;
 	}
 }
 
@@ -207,6 +602,7 @@ MapLayer::MapLayer(MapLayerType type)
 	: opacity	(1.f),
 	visible		(true),
 	type		(type),
+	parallaxFactor	(1.f, 1.f),
 	m_shader	(nullptr)
 {}
 
@@ -215,10 +611,103 @@ void MapLayer::setShader(const sf::Shader& shader)
 	m_shader = &shader;
 }
 
-void MapLayer::cull(const sf::FloatRect& bounds)
+sf::Vector2f MapLayer::updateTransform(const sf::Vector2f& viewCentre, const sf::Vector2f& parallaxOrigin)
+{
+	//a layer with a parallax factor below 1 is carried along with the view by the remainder
+	const sf::Vector2f distance = viewCentre - parallaxOrigin;
+	m_translation.x = offset.x + distance.x * (1.f - parallaxFactor.x);
+	m_translation.y = offset.y + distance.y * (1.f - parallaxFactor.y);
+
+	m_transform = sf::Transform::Identity;
+	m_transform.translate(m_translation);
+	return m_translation;
+}
+
+void MapLayer::cull(const sf::FloatRect& bounds, const sf::IntRect& tileBounds, float scale)
 {
 	for(auto& ls : layerSets)
-		ls.second->cull(bounds);
+		ls.second->cull(bounds, tileBounds, scale);
+}
+
+bool MapLayer::updateQuads() const
+{
+	bool grown = false;
+	for(const auto& ls : layerSets)
+	{
+		if(ls.second->updateQuads())
+			grown = true;
+	}
+	return grown;
+}
+
+void MapLayer::drawSorted(sf::RenderTarget& rt, const DepthSorter& drawables, sf::RenderStates states) const
+{
+	const auto& entries = drawables.getEntries();
+	auto next = entries.begin();
+
+	//drawables only take the transform passed in, not the layer's own transform or shader
+	sf::RenderStates drawableStates;
+	drawableStates.transform = states.transform;
+
+	//drawable depths are in world space, bands are in layer space
+	const float depthOffset = m_translation.y;
+
+	if(visible)
+	{
+		states.shader = m_shader;
+		states.transform *= m_transform;
+
+		//find the bands visible in any set. Sets without bands can't be interleaved so are drawn first
+		sf::Int32 first = std::numeric_limits<sf::Int32>::max();
+		sf::Int32 last = std::numeric_limits<sf::Int32>::min();
+		float bandHeight = 0.f;
+		m_bandedSets.clear();
+		for(const auto& ls : layerSets)
+		{
+			sf::Int32 setFirst, setLast;
+			if(ls.second->getVisibleBands(setFirst, setLast))
+			{
+				m_bandedSets.push_back(ls.second.get());
+				first = std::min(first, setFirst);
+				last = std::max(last, setLast);
+				bandHeight = ls.second->getBandHeight();
+			}
+			else
+			{
+				rt.draw(*ls.second, states);
+			}
+		}
+
+		if(!m_bandedSets.empty())
+		{
+			//drawables in front of every visible band
+			while(next != entries.end() && next->depth - depthOffset < static_cast<float>(first) * bandHeight)
+				rt.draw(*(next++)->drawable, drawableStates);
+
+			for(auto band = first; band <= last; ++band)
+			{
+				for(auto ls : m_bandedSets)
+					ls->drawBand(rt, states, band);
+
+				const float bandEnd = static_cast<float>(band + 1) * bandHeight;
+				while(next != entries.end() && next->depth - depthOffset < bandEnd)
+					rt.draw(*(next++)->drawable, drawableStates);
+			}
+		}
+
+		if(type == ImageLayer)
+		{
+			for(const auto& tile : tiles)
+			{
+				sf::RenderStates tileStates = tile.renderStates;
+				tileStates.transform = states.transform * tile.renderStates.transform;
+				rt.draw(tile.sprite, tileStates);
+			}
+		}
+	}
+
+	while(next != entries.end())
+		rt.draw(*(next++)->drawable, drawableStates);
 }
 
 //private
@@ -227,6 +716,7 @@ void MapLayer::draw(sf::RenderTarget& rt, sf::RenderStates states) const
 	if(!visible) return; //skip invisible layers
 
 	states.shader = m_shader;
+	states.transform *= m_transform;
 	for(const auto& ls : layerSets)
 	{
 		rt.draw(*ls.second, states);
@@ -237,7 +727,9 @@ void MapLayer::draw(sf::RenderTarget& rt, sf::RenderStates states) const
 		//draw tiles used on objects
 		for(const auto& tile : tiles)
 		{
-			rt.draw(tile.sprite, tile.renderStates);
+			sf::RenderStates tileStates = tile.renderStates;
+			tileStates.transform = states.transform * tile.renderStates.transform;
+			rt.draw(tile.sprite, tileStates);
 		}
 	}
 }
@@ -31,6 +31,8 @@ it freely, subject to the following restrictions:
 
 #include "miniz.h"
 
+#include <SFML/System/Clock.hpp>
+
 #ifdef _MSC_VER
 #ifdef LoadImage
 #undef LoadImage
@@ -41,6 +43,7 @@ it freely, subject to the following restrictions:
 #include <cstring>
 #include <sstream>
 #include <functional>
+#include <limits>
 
 namespace
 {
@@ -55,6 +58,11 @@ namespace
     private:
         const std::string m_name;
     };
+
+    //flags set in the upper bits of a GID when a tile is flipped
+    const sf::Uint32 FLIP_FLAGS = 0xE0000000;
+    //roughly how many vertices cost the same as one extra draw call
+    const float DRAW_CALL_COST = 1000.f;
 }
 
 using namespace tmx;
@@ -72,6 +80,11 @@ bool MapLoader::loadFromXmlDoc(const pugi::xml_document& mapDoc)
 	//load map textures / tilesets
 	if(!(m_mapLoaded = parseTileSets(mapNode))) return false;
 
+	//tiles taller than the grid are drawn upwards, so may be visible from the cell below the view
+	m_tileOverhang = 0.f;
+	for(const auto& info : m_tileInfo)
+		m_tileOverhang = std::max(m_tileOverhang, info.Size.y - static_cast<float>(m_tileHeight));
+
 	//actually we need to traverse map node children and parse each layer as found
 	pugi::xml_node currentNode = mapNode.first_child();
 	while(currentNode)
@@ -106,6 +119,51 @@ bool MapLoader::loadFromXmlDoc(const pugi::xml_document& mapDoc)
 
 	createDebugGrid();
 
+	//objects on static layers never move, so are indexed once here
+	std::vector<const MapObject*> staticObjects;
+	for(const auto& layer : m_layers)
+	{
+		if(!isStaticLayer(layer)) continue;
+		for(const auto& object : layer.objects)
+			staticObjects.push_back(&object);
+	}
+	m_staticTree.build(staticObjects);
+	if(!staticObjects.empty())
+	{
+		LOG("Built static tree of " + std::to_string(staticObjects.size()) + " objects.", Logger::Type::Info);
+	}
+
+	for(auto& layer : m_layers)
+	{
+		for(auto& object : layer.objects)
+			m_objectIndex.insert(object);
+	}
+
+	if(m_depthSorting)
+	{
+		//tiles in the same band are drawn in row order, so a band is the smallest step
+		//between the bottoms of tiles which may overlap
+		float bandHeight = getCellStride().y;
+		if(m_orientation == MapOrientation::Isometric || getStaggerOffset().y > 0.f) bandHeight /= 2.f;
+
+		for(auto& layer : m_layers)
+		{
+			for(auto& ls : layer.layerSets)
+				ls.second->buildDepthBands(bandHeight);
+		}
+	}
+
+	if(m_lodLevelCount > 0u)
+	{
+		LOG("Building level of detail textures, please wait...", Logger::Type::Info);
+		for(auto& layer : m_layers)
+		{
+			if(layer.type != Layer) continue;
+			for(auto& ls : layer.layerSets)
+				ls.second->buildLod(m_lodLevelCount, m_minTexelDensity);
+		}
+	}
+
 	LOG("Parsed " + std::to_string(m_layers.size()) + " layers.", Logger::Type::Info);
 	LOG("Loaded tmx file successfully.", Logger::Type::Info);
 
@@ -117,17 +175,35 @@ void MapLoader::unload()
 {
 	m_tilesetTextures.clear();
 	m_tileInfo.clear();
+	m_animations.clear();
+	m_animationFrames.clear();
+	m_animationTime = sf::Time::Zero;
 	m_layers.clear();
 	m_imageLayerTextures.clear();
     m_cachedImages.clear();
 	m_mapLoaded = false;
 	m_quadTreeAvailable = false;
+	m_staticTree.clear();
+	m_objectIndex.clear();
+	m_addedObjects.clear();
+	m_removedObjects.clear();
 	m_failedImage = false;
+	m_lastViewPos = m_lastViewSize = sf::Vector2f();
 }
 
-void MapLoader::setDrawingBounds(const sf::View& view)
+void MapLoader::setDrawingBounds(const sf::RenderTarget& rt) const
 {
-	if(view.getCenter() != m_lastViewPos)
+	const sf::View& view = rt.getView();
+
+	//moved tiles may have grown their patches into view, which needs culling again
+	bool quadsGrown = false;
+	for(const auto& layer : m_layers)
+	{
+		if(layer.updateQuads())
+			quadsGrown = true;
+	}
+
+	if(quadsGrown || view.getCenter() != m_lastViewPos || view.getSize() != m_lastViewSize)
 	{
 		sf::FloatRect bounds;
 		bounds.left = view.getCenter().x - (view.getSize().x / 2.f);
@@ -142,10 +218,103 @@ void MapLoader::setDrawingBounds(const sf::View& view)
 		bounds.height += static_cast<float>(m_tileHeight * 2);
 		m_bounds = bounds;
 
+		//screen pixels per world unit, used to select level of detail
+		const float scale = static_cast<float>(rt.getViewport(view).width) / view.getSize().x;
+
+		const sf::IntRect tileBounds = getTileBounds(m_bounds);
 		for(auto& layer : m_layers)
-			layer.cull(m_bounds);
+		{
+			//layers which are offset, or scroll at their own rate, are culled in their own space
+			const sf::Vector2f translation = layer.updateTransform(view.getCenter(), m_parallaxOrigin);
+			if(translation == sf::Vector2f())
+			{
+				layer.cull(m_bounds, tileBounds, scale);
+			}
+			else
+			{
+				sf::FloatRect layerBounds = m_bounds;
+				layerBounds.left -= translation.x;
+				layerBounds.top -= translation.y;
+				layer.cull(layerBounds, getTileBounds(layerBounds), scale);
+			}
+		}
 	}
 	m_lastViewPos = view.getCenter();
+	m_lastViewSize = view.getSize();
+}
+
+sf::IntRect MapLoader::getTileBounds(const sf::FloatRect& bounds) const
+{
+	const float right = bounds.left + bounds.width;
+	const float bottom = bounds.top + bounds.height + m_tileOverhang;
+
+	sf::Vector2f min, max;
+	if(m_orientation == MapOrientation::Isometric)
+	{
+		//map each corner of the view back into grid space, where the view becomes a
+		//diamond, and take its bounds. This is the inverse of the offset in addTileRow()
+		const float halfWidth = static_cast<float>(m_tileWidth / 2u);
+		const float halfHeight = static_cast<float>(m_tileHeight / 2u);
+		const std::array<sf::Vector2f, 4u> corners = 
+		{{
+			sf::Vector2f(bounds.left, bounds.top),
+			sf::Vector2f(right, bounds.top),
+			sf::Vector2f(right, bottom),
+			sf::Vector2f(bounds.left, bottom)
+		}};
+
+		min = sf::Vector2f(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+		max = sf::Vector2f(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
+		for(const auto& c : corners)
+		{
+			const float column = c.x / halfWidth;
+			const float row = c.y / halfHeight - 2.f;
+			const sf::Vector2f grid((row + column) / 2.f, (row - column) / 2.f);
+			min.x = std::min(min.x, grid.x);
+			min.y = std::min(min.y, grid.y);
+			max.x = std::max(max.x, grid.x);
+			max.y = std::max(max.y, grid.y);
+		}
+	}
+	else
+	{
+		//staggered cells are offset by less than a stride, and their quads are
+		//less than two strides wide, so are covered by the spare tile below
+		const sf::Vector2f stride = getCellStride();
+		min = sf::Vector2f(bounds.left / stride.x, bounds.top / stride.y);
+		max = sf::Vector2f(right / stride.x, bottom / stride.y);
+	}
+
+	//round outwards, with a tile to spare for tiles whose quads are offset from their cell
+	const int left = static_cast<int>(std::floor(min.x)) - 1;
+	const int top = static_cast<int>(std::floor(min.y)) - 1;
+	return sf::IntRect(left, top, static_cast<int>(std::ceil(max.x)) + 1 - left, static_cast<int>(std::ceil(max.y)) + 1 - top);
+}
+
+sf::Vector2f MapLoader::getCellStride() const
+{
+	if(m_orientation == MapOrientation::SteppedIsometric || m_orientation == MapOrientation::Hexagonal)
+	{
+		//see Tiled's hexagonal renderer. Only the staggered axis is interleaved, where each
+		//cell advances by half a tile plus the length of the flat side
+		const float tileWidth = static_cast<float>(m_tileWidth & ~1);
+		const float tileHeight = static_cast<float>(m_tileHeight & ~1);
+		const float sideLength = static_cast<float>(m_hexSideLength);
+		return (m_staggerX) ?
+			sf::Vector2f((tileWidth + sideLength) / 2.f, tileHeight) :
+			sf::Vector2f(tileWidth, (tileHeight + sideLength) / 2.f);
+	}
+	return sf::Vector2f(static_cast<float>(m_tileWidth), static_cast<float>(m_tileHeight));
+}
+
+sf::Vector2f MapLoader::getStaggerOffset() const
+{
+	if(m_orientation == MapOrientation::SteppedIsometric || m_orientation == MapOrientation::Hexagonal)
+	{
+		const sf::Vector2f stride = getCellStride();
+		return (m_staggerX) ? sf::Vector2f(0.f, stride.y / 2.f) : sf::Vector2f(stride.x / 2.f, 0.f);
+	}
+	return sf::Vector2f();
 }
 
 bool MapLoader::parseMapNode(const pugi::xml_node& mapNode)
@@ -172,12 +341,30 @@ bool MapLoader::parseMapNode(const pugi::xml_node& mapNode)
 		m_orientation = MapOrientation::Isometric;
 		m_tileRatio = static_cast<float>(m_tileWidth) / static_cast<float>(m_tileHeight);
 	}
+	else if(orientation == "staggered" || orientation == "hexagonal")
+	{
+		//staggered maps are laid out as hexagonal maps with no side length
+		m_orientation = (orientation == "staggered") ? MapOrientation::SteppedIsometric : MapOrientation::Hexagonal;
+		m_staggerX = (std::string(mapNode.attribute("staggeraxis").as_string("y")) == "x");
+		m_staggerEven = (std::string(mapNode.attribute("staggerindex").as_string("odd")) == "even");
+		m_hexSideLength = (m_orientation == MapOrientation::Hexagonal) ? mapNode.attribute("hexsidelength").as_uint() : 0u;
+
+		const sf::Uint16 size = (m_staggerX) ? m_tileWidth : m_tileHeight;
+		if(m_hexSideLength > size)
+		{
+			LOG("Hex side length larger than tile size, clamping to tile size.", Logger::Type::Warning);
+			m_hexSideLength = size;
+		}
+	}
 	else
 	{
 		LOG("Map orientation " + orientation + " not currently supported. Map not loaded.", Logger::Type::Error);
 		return false;
 	}
 
+	m_parallaxOrigin.x = mapNode.attribute("parallaxoriginx").as_float();
+	m_parallaxOrigin.y = mapNode.attribute("parallaxoriginy").as_float();
+
 	//parse any map properties
 	if(pugi::xml_node propertiesNode = mapNode.child("properties"))
 	{
@@ -308,6 +495,7 @@ bool MapLoader::processTiles(const pugi::xml_node& tilesetNode)
 	//TODO parse any tile properties and store with offset above
 
 	//slice into tiles
+	const sf::Uint32 firstGid = m_tileInfo.size();
 	int columns = (sourceImage.getSize().x - 2u * margin + spacing) / (tileWidth + spacing);
 	int rows = (sourceImage.getSize().y - 2u * margin + spacing) / (tileHeight + spacing);
 
@@ -326,14 +514,67 @@ bool MapLoader::processTiles(const pugi::xml_node& tilesetNode)
 			//store texture coords and tileset index for vertex array
 			m_tileInfo.push_back(TileInfo(rect,
 				sf::Vector2f(static_cast<float>(rect.width), static_cast<float>(rect.height)),
-				m_tilesetTextures.size() - 1u));
+				m_tilesetTextures.size() - 1u, m_flipCorners));
 		}
 	}
 
+	parseTileAnimations(tilesetNode, firstGid);
+
 	LOG("Processed " + imageName, Logger::Type::Info);
 	return true;
 }
 
+void MapLoader::parseTileAnimations(const pugi::xml_node& tilesetNode, sf::Uint32 firstGid)
+{
+	for(const auto& tileNode : tilesetNode.children("tile"))
+	{
+		const pugi::xml_node animationNode = tileNode.child("animation");
+		if(!animationNode) continue;
+
+		const sf::Uint32 gid = firstGid + tileNode.attribute("id").as_uint();
+		if(gid >= m_tileInfo.size())
+		{
+			LOG("Animated tile ID outside of tileset, skipping animation.", Logger::Type::Warning);
+			continue;
+		}
+
+		//frames refer to tiles in the same tileset, so share its texture
+		TileAnimation animation;
+		for(const auto& frameNode : animationNode.children("frame"))
+		{
+			const sf::Uint32 frameGid = firstGid + frameNode.attribute("tileid").as_uint();
+			const sf::Int64 duration = static_cast<sf::Int64>(frameNode.attribute("duration").as_uint()) * 1000;
+			if(frameGid >= m_tileInfo.size() || duration == 0)
+			{
+				LOG("Invalid animation frame found, skipping frame.", Logger::Type::Warning);
+				continue;
+			}
+			animation.frames.push_back(std::make_pair(frameGid, duration));
+			animation.duration += duration;
+		}
+		if(animation.frames.empty()) continue;
+
+		m_tileInfo[gid].AnimationId = static_cast<sf::Int32>(m_animations.size());
+		m_animations.push_back(animation);
+		m_animationFrames.emplace_back();
+		setAnimationFrame(m_animations.size() - 1u, 0u);
+	}
+
+	if(!m_animations.empty())
+	{
+		LOG("Found " + std::to_string(m_animations.size()) + " tile animations", Logger::Type::Info);
+	}
+}
+
+void MapLoader::setAnimationFrame(sf::Uint32 animation, sf::Uint32 frame)
+{
+	const auto& info = m_tileInfo[m_animations[animation].frames[frame].first];
+	auto& current = m_animationFrames[animation];
+
+	current.texCoords = info.TexCoords[0]; //layer sets apply any flipping
+	current.index = frame;
+}
+
 bool MapLoader::parseCollectionOfImages(const pugi::xml_node& tilesetNode)
 {
     if (pugi::xml_node tile = tilesetNode.child("tile"))
@@ -373,7 +614,7 @@ bool MapLoader::parseCollectionOfImages(const pugi::xml_node& tilesetNode)
                     //TODO this assumes tile IDs are contiguous - they aren't always!
                     m_tileInfo.push_back(TileInfo(rect,
                         sf::Vector2f(static_cast<float>(rect.width), static_cast<float>(rect.height)),
-                        m_tilesetTextures.size() - 1u));
+                        m_tilesetTextures.size() - 1u, m_flipCorners));
 
                     LOG("Processed " + imageName, Logger::Type::Info);
                 }
@@ -397,6 +638,7 @@ bool MapLoader::parseLayer(const pugi::xml_node& layerNode)
 	if(layerNode.attribute("name")) layer.name = layerNode.attribute("name").as_string();
 	if(layerNode.attribute("opacity")) layer.opacity = layerNode.attribute("opacity").as_float();
 	if(layerNode.attribute("visible")) layer.visible = layerNode.attribute("visible").as_bool();
+	parseLayerTransform(layerNode, layer);
 
 	pugi::xml_node dataNode;
 	if(!(dataNode = layerNode.child("data")))
@@ -404,6 +646,11 @@ bool MapLoader::parseLayer(const pugi::xml_node& layerNode)
 		LOG("Layer data missing or corrupt. Map not loaded.", Logger::Type::Error);
 		return false;
 	}
+
+	//decode all the tile GIDs first so the whole layer is known before creating any patches
+	std::vector<sf::Uint32> tileGIDs;
+	tileGIDs.reserve(m_width * m_height);
+
 	//decode and decompress data first if necessary. See https://github.com/bjorn/tiled/wiki/TMX-Map-Format#data
 	//for explanation of bytestream retrieved when using compression
 	if(dataNode.attribute("encoding"))
@@ -444,56 +691,27 @@ bool MapLoader::parseLayer(const pugi::xml_node& layerNode)
 				byteArray.insert(byteArray.end(), data.begin(), data.end());
 			}
 
-			//extract tile GIDs using bitshift (See https://github.com/bjorn/tiled/wiki/TMX-Map-Format#data) and add the tiles to layer
-			sf::Uint16 x, y;
-			x = y = 0;
-			for(int i = 0; i < expectedSize - 3; i +=4)
+			//extract tile GIDs using bitshift (See https://github.com/bjorn/tiled/wiki/TMX-Map-Format#data)
+			const int byteCount = std::min(expectedSize, static_cast<int>(byteArray.size()));
+			for(int i = 0; i < byteCount - 3; i +=4)
 			{
-                sf::Uint32 tileGID = byteArray[i] | byteArray[i + 1] << 8 | byteArray[i + 2] << 16 | byteArray[i + 3] << 24;
-//                sf::Uint32 tileGID = resolveRotation(&byteArray[i]);
-
-
-				addTileToLayer(layer, x, y, tileGID);
-
-				x++;
-				if(x == m_width)
-				{
-					x = 0;
-					y++;
-				}
+				tileGIDs.push_back(byteArray[i] | byteArray[i + 1] << 8 | byteArray[i + 2] << 16 | byteArray[i + 3] << 24);
 			}
 		}
 		else if(encoding == "csv")
 		{
 			LOG("CSV encoded layer data found.", Logger::Type::Info);
 
-            std::vector<sf::Uint32> tileGIDs;
 			std::stringstream datastream(data);
 
 			//parse csv string into vector of IDs
-            sf::Uint32 i;
+			sf::Uint32 i;
 			while (datastream >> i)
 			{
-
-                tileGIDs.push_back(i);
+				tileGIDs.push_back(i);
 				if(datastream.peek() == ',')
 					datastream.ignore();
 			}
-
-			//create tiles from IDs
-			sf::Uint16 x, y;
-			x = y = 0;
-			for(unsigned int i = 0; i < tileGIDs.size(); i++)
-			{
-//                sf::Uint32 gid=resolveRotation(tileGIDs[i]);
-                addTileToLayer(layer, x, y, tileGIDs[i]);
-				x++;
-				if(x == m_width)
-				{
-					x = 0;
-					y++;
-				}
-			}
 		}
 		else
 		{
@@ -511,27 +729,28 @@ bool MapLoader::parseLayer(const pugi::xml_node& layerNode)
 			return false;
 		}
 
-		sf::Uint16 x, y;
-		x = y = 0;
 		while(tileNode)
 		{
-            sf::Uint32 gid = tileNode.attribute("gid").as_uint();
-
-//            gid=resolveRotation(gid);
-
-
-			addTileToLayer(layer, x, y, gid);
-
+			tileGIDs.push_back(tileNode.attribute("gid").as_uint());
 			tileNode = tileNode.next_sibling("tile");
-			x++;
-			if(x == m_width)
-			{
-				x = 0;
-				y++;
-			}
 		}
 	}
 
+	//pick the patch size now the contents of the layer are known
+	layer.patchInfo = calcPatchInfo(tileGIDs, (m_autoPatchSize) ? choosePatchSize(tileGIDs) : m_patchSize);
+	LOG("Using patch size " + std::to_string(layer.patchInfo.patchSize) + " for layer " + layer.name, Logger::Type::Info);
+
+	if(tileGIDs.size() != static_cast<std::size_t>(m_width * m_height))
+	{
+		LOG("Layer " + layer.name + " has the wrong number of tiles, missing tiles will be empty.", Logger::Type::Warning);
+		tileGIDs.resize(m_width * m_height, 0u);
+	}
+
+	//create tiles from IDs a row at a time
+	std::vector<sf::Vertex> rowVertices(m_width * 4u);
+	for(sf::Uint16 y = 0u; y < m_height; ++y)
+		addTileRow(layer, y, &tileGIDs[y * m_width], rowVertices.data());
+
 	//parse any layer properties
 	if(pugi::xml_node propertiesNode = layerNode.child("properties"))
 		parseLayerProperties(propertiesNode, layer);
@@ -543,36 +762,89 @@ bool MapLoader::parseLayer(const pugi::xml_node& layerNode)
 	return true;
 }
 
-std::vector<unsigned char> MapLoader::intToBytes(sf::Uint32 paramInt)
+MapLayer::PatchInfo MapLoader::calcPatchInfo(const std::vector<sf::Uint32>& tileGIDs, sf::Uint8 patchSize) const
+{
+	//a patch size of 0 places the whole layer in a single patch
+	const sf::Uint32 patchWidth = (patchSize > 0u) ? patchSize : std::max(1u, static_cast<sf::Uint32>(m_width));
+	const sf::Uint32 patchHeight = (patchSize > 0u) ? patchSize : std::max(1u, static_cast<sf::Uint32>(m_height));
+	const sf::Uint32 patchCountX = (m_width + patchWidth - 1u) / patchWidth;
+	const sf::Uint32 patchCountY = (m_height + patchHeight - 1u) / patchHeight;
+
+	//count the tiles and patches which actually contain something
+	std::vector<bool> filled(patchCountX * patchCountY);
+	sf::Uint32 tileCount = 0u;
+	sf::Uint32 filledCount = 0u;
+	const auto size = std::min(tileGIDs.size(), static_cast<std::size_t>(m_width * m_height));
+	for(auto i = 0u; i < size; ++i)
+	{
+		if((tileGIDs[i] & ~FLIP_FLAGS) == 0u) continue;
+
+		tileCount++;
+		const auto patch = ((i / m_width) / patchHeight) * patchCountX + ((i % m_width) / patchWidth);
+		if(!filled[patch])
+		{
+			filled[patch] = true;
+			filledCount++;
+		}
+	}
+
+	//the culling bounds include a one tile border
+	const sf::Vector2f viewSize(m_expectedViewSize.x + static_cast<float>(m_tileWidth * 2u), m_expectedViewSize.y + static_cast<float>(m_tileHeight * 2u));
+	const sf::Vector2f patchArea(static_cast<float>(patchWidth * m_tileWidth), static_cast<float>(patchHeight * m_tileHeight));
+	const float patchFill = static_cast<float>(filledCount) / static_cast<float>(patchCountX * patchCountY);
+	const float tileFill = static_cast<float>(tileCount) / static_cast<float>(m_width * m_height);
+
+	//a view at a random position overlaps on average (view / patch + 1) patches along each axis
+	const float overlappedArea = (viewSize.x + patchArea.x) * (viewSize.y + patchArea.y);
+
+	MapLayer::PatchInfo info;
+	info.patchSize = patchSize;
+	info.expectedDrawCalls = (viewSize.x / patchArea.x + 1.f) * (viewSize.y / patchArea.y + 1.f) * patchFill;
+	info.expectedVertices = overlappedArea / static_cast<float>(m_tileWidth * m_tileHeight) * tileFill * 4.f;
+	info.expectedOverdraw = overlappedArea / (viewSize.x * viewSize.y);
+	return info;
+}
+
+sf::Uint8 MapLoader::choosePatchSize(const std::vector<sf::Uint32>& tileGIDs) const
 {
-     std::vector<unsigned char> arrayOfByte(4);
-     for (int i = 0; i < 4; i++)
-         arrayOfByte[i] = (paramInt >> (i * 8));
-     return arrayOfByte;
+	//larger patches mean fewer draw calls but more vertices drawn off screen.
+	//0 is tried last and places the whole layer in a single patch
+	const sf::Uint8 candidates[] = { 4u, 6u, 8u, 10u, 12u, 16u, 20u, 24u, 32u, 48u, 64u, 96u, 128u, 192u, 255u, 0u };
+
+	sf::Uint8 bestSize = m_patchSize;
+	float bestCost = std::numeric_limits<float>::max();
+	for(auto size : candidates)
+	{
+		const auto info = calcPatchInfo(tileGIDs, size);
+		const float cost = info.expectedDrawCalls * DRAW_CALL_COST + info.expectedVertices;
+		if(cost < bestCost)
+		{
+			bestCost = cost;
+			bestSize = size;
+		}
+
+		//patches bigger than the map won't make any difference
+		if(size >= m_width && size >= m_height) break;
+	}
+	return bestSize;
 }
 
-std::pair<sf::Uint32, std::bitset<3> > MapLoader::resolveRotation(sf::Uint32 gid)
+void MapLoader::createFlipCorners()
 {
-    const unsigned FLIPPED_HORIZONTALLY_FLAG = 0x80000000;
-    const unsigned FLIPPED_VERTICALLY_FLAG   = 0x40000000;
-    const unsigned FLIPPED_DIAGONALLY_FLAG   = 0x20000000;
-
-    std::vector<unsigned char> bytes = intToBytes(gid);
-    sf::Uint32 tileGID = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | bytes[3] << 24;
-
-    bool flipped_diagonally = (tileGID & FLIPPED_DIAGONALLY_FLAG);
-    bool flipped_horizontally = (tileGID & FLIPPED_HORIZONTALLY_FLAG);
-    bool flipped_vertically = (tileGID & FLIPPED_VERTICALLY_FLAG);
-
-    std::bitset<3> b;
-    b.set(0,flipped_vertically);
-    b.set(1,flipped_horizontally);
-    b.set(2,flipped_diagonally);
-
-    tileGID &= ~(FLIPPED_HORIZONTALLY_FLAG |
-                            FLIPPED_VERTICALLY_FLAG |
-                            FLIPPED_DIAGONALLY_FLAG);
-    return std::pair<sf::Uint32, std::bitset<3> >(tileGID,b);
+	for(auto i = 0u; i < m_flipCorners.size(); ++i)
+	{
+		//the flip bits of a GID shifted down are horizontal, vertical, diagonal from high to low
+		std::bitset<3> bits;
+		bits.set(0, (i & 0x2) != 0);
+		bits.set(1, (i & 0x4) != 0);
+		bits.set(2, (i & 0x1) != 0);
+
+		std::array<sf::Vector2f, 4u> unit = {{ sf::Vector2f(0.f, 0.f), sf::Vector2f(1.f, 0.f), sf::Vector2f(1.f, 1.f), sf::Vector2f(0.f, 1.f) }};
+		doFlips(bits, &unit[0], &unit[1], &unit[2], &unit[3]);
+
+		for(auto j = 0u; j < 4u; ++j)
+			m_flipCorners[i][j] = (unit[j].y > 0.5f) ? ((unit[j].x > 0.5f) ? 2u : 3u) : ((unit[j].x > 0.5f) ? 1u : 0u);
+	}
 }
 
 void MapLoader::flipY(sf::Vector2f *v0, sf::Vector2f *v1, sf::Vector2f *v2, sf::Vector2f *v3)
@@ -666,77 +938,129 @@ void MapLoader::doFlips(std::bitset<3> bits, sf::Vector2f *v0, sf::Vector2f *v1,
     }
 }
 
-TileQuad* MapLoader::addTileToLayer(MapLayer& layer, sf::Uint16 x, sf::Uint16 y, sf::Uint32 gid, const sf::Vector2f& offset)
+void MapLoader::addTileRow(MapLayer& layer, sf::Uint16 y, const sf::Uint32* gids, sf::Vertex* vertices)
 {
-	sf::Uint8 opacity = static_cast<sf::Uint8>(255.f * layer.opacity);
-	sf::Color colour = sf::Color(255u, 255u, 255u, opacity);
+	const sf::Color colour(255u, 255u, 255u, static_cast<sf::Uint8>(255.f * layer.opacity));
+	const sf::Uint32 maxId = static_cast<sf::Uint32>(m_tileInfo.size() - 1u);
+	const float tileHeight = static_cast<float>(m_tileHeight);
+
+	//tile positions are linear along a row, so orientation only changes the origin and step,
+	//plus an offset applied to alternate columns of maps staggered along the x axis
+	const sf::Vector2f stride = getCellStride();
+	sf::Vector2f origin(0.f, stride.y * static_cast<float>(y));
+	sf::Vector2f step(stride.x, 0.f);
+	sf::Vector2f columnStagger;
+	sf::Uint32 staggerParity = (m_staggerEven) ? 1u : 0u;
+	if(m_orientation == MapOrientation::SteppedIsometric || m_orientation == MapOrientation::Hexagonal)
+	{
+		if(m_staggerX)
+			columnStagger = getStaggerOffset();
+		else if(((y & 1u) ^ staggerParity) != 0u)
+			origin += getStaggerOffset();
+	}
+	else if(m_orientation == MapOrientation::Isometric)
+	{
+		const float halfWidth = static_cast<float>(m_tileWidth / 2u);
+		const float halfHeight = static_cast<float>(m_tileHeight / 2u);
+		origin.x -= static_cast<float>(y) * halfWidth + halfWidth;
+		origin.y += halfHeight - static_cast<float>(y) * halfHeight;
+		step.x -= halfWidth;
+		step.y += halfHeight;
+	}
 
-    //Get bits and tile id
-    std::pair<sf::Uint32, std::bitset<3> > idAndFlags = resolveRotation(gid);
-    gid = idAndFlags.first;
+	//build every quad in the row. Empty or invalid IDs use the empty tile info rather than branching
+	for(auto x = 0u; x < m_width; ++x)
+	{
+		const sf::Uint32 id = gids[x] & ~FLIP_FLAGS;
+		const auto& info = m_tileInfo[(id > maxId) ? 0u : id];
+		const auto& texCoords = info.TexCoords[gids[x] >> 29];
+
+		//tiles taller than the map grid are aligned to the bottom of the cell
+		const sf::Vector2f position = origin + step * static_cast<float>(x) + columnStagger * static_cast<float>((x & 1u) ^ staggerParity)
+			+ sf::Vector2f(0.f, tileHeight - info.Size.y);
+
+		sf::Vertex* quad = vertices + x * 4u;
+		quad[0] = sf::Vertex(position, colour, texCoords[0]);
+		quad[1] = sf::Vertex(sf::Vector2f(position.x + info.Size.x, position.y), colour, texCoords[1]);
+		quad[2] = sf::Vertex(position + info.Size, colour, texCoords[2]);
+		quad[3] = sf::Vertex(sf::Vector2f(position.x, position.y + info.Size.y), colour, texCoords[3]);
+	}
 
-	//update the layer's tile set(s)
-    sf::Vertex v0, v1, v2, v3;
+	//then add the non-empty quads to the set for their tileset
+	LayerSet* layerSet = nullptr;
+	sf::Uint16 tilesetId = 0u;
+	for(sf::Uint16 x = 0u; x < m_width; ++x)
+	{
+		const sf::Uint32 id = gids[x] & ~FLIP_FLAGS;
+		if(id == 0u || id > maxId) continue;
 
-	//applying half pixel trick avoids artifacting when scrolling
-	v0.texCoords = m_tileInfo[gid].Coords[0] + sf::Vector2f(0.5f, 0.5f);
-	v1.texCoords = m_tileInfo[gid].Coords[1] + sf::Vector2f(-0.5f, 0.5f);
-	v2.texCoords = m_tileInfo[gid].Coords[2] + sf::Vector2f(-0.5f, -0.5f);
-	v3.texCoords = m_tileInfo[gid].Coords[3] + sf::Vector2f(0.5f, -0.5f);
+		const auto& info = m_tileInfo[id];
+		if(!layerSet || info.TileSetId != tilesetId)
+		{
+			tilesetId = info.TileSetId;
+			layerSet = &getLayerSet(layer, tilesetId);
+		}
 
-    //flip texture coordinates according to bits set
-    doFlips(idAndFlags.second,&v0.texCoords,&v1.texCoords,&v2.texCoords,&v3.texCoords);
+		layerSet->addTile(vertices + x * 4u, x, y);
+		if(info.AnimationId > -1)
+			layerSet->animateLastTile(m_animationFrames, info.AnimationId, m_flipCorners[gids[x] >> 29]);
+	}
+}
 
-	v0.position = sf::Vector2f(static_cast<float>(m_tileWidth * x), static_cast<float>(m_tileHeight * y));
-	v1.position = sf::Vector2f(static_cast<float>(m_tileWidth * x) + m_tileInfo[gid].Size.x, static_cast<float>(m_tileHeight * y));
-	v2.position = sf::Vector2f(static_cast<float>(m_tileWidth * x) + m_tileInfo[gid].Size.x, static_cast<float>(m_tileHeight * y) + m_tileInfo[gid].Size.y);
-	v3.position = sf::Vector2f(static_cast<float>(m_tileWidth * x), static_cast<float>(m_tileHeight * y) + m_tileInfo[gid].Size.y);
+LayerSet& MapLoader::getLayerSet(MapLayer& layer, sf::Uint16 tilesetId)
+{
+	auto result = layer.layerSets.find(tilesetId);
+	if(result == layer.layerSets.end())
+	{
+		//create a new layerset for texture
+		result = layer.layerSets.insert(std::make_pair(tilesetId, std::make_shared<LayerSet>(*m_tilesetTextures[tilesetId], layer.patchInfo.patchSize, sf::Vector2u(m_width, m_height), sf::Vector2u(m_tileWidth, m_tileHeight)))).first;
+	}
+	return *result->second;
+}
 
-	//offset tiles with size not equal to map grid size
-	sf::Uint16 tileHeight = static_cast<sf::Uint16>(m_tileInfo[gid].Size.y);
-	if(tileHeight != m_tileHeight)
+TileQuad* MapLoader::addTileToLayer(MapLayer& layer, sf::Uint16 x, sf::Uint16 y, sf::Uint32 gid, const sf::Vector2f& offset)
+{
+	const sf::Uint32 flips = gid >> 29;
+	gid &= ~FLIP_FLAGS;
+	if(gid >= m_tileInfo.size())
 	{
-		float diff = static_cast<float>(m_tileHeight - tileHeight);
-		v0.position.y += diff;
-		v1.position.y += diff;
-		v2.position.y += diff;
-		v3.position.y += diff;
+		LOG("Invalid tile GID " + std::to_string(gid) + ", using empty tile", Logger::Type::Warning);
+		gid = 0u;
 	}
+	const auto& info = m_tileInfo[gid];
+
+	//build the quad the same way as addTileRow() does for a single tile
+	std::array<sf::Vertex, 4u> vertices;
+	//object tiles are positioned in pixels, so staggering doesn't apply
+	const sf::Vector2f stride = getCellStride();
+	vertices[0] = sf::Vertex(sf::Vector2f(stride.x * x, stride.y * y + static_cast<float>(m_tileHeight) - info.Size.y));
+	vertices[1].position = vertices[0].position + sf::Vector2f(info.Size.x, 0.f);
+	vertices[2].position = vertices[0].position + info.Size;
+	vertices[3].position = vertices[0].position + sf::Vector2f(0.f, info.Size.y);
 
 	//adjust position for isometric maps
+	sf::Vector2f isoOffset;
 	if(m_orientation == MapOrientation::Isometric)
 	{
-		sf::Vector2f isoOffset(-static_cast<float>(x * (m_tileWidth / 2u)), static_cast<float>(x * (m_tileHeight / 2u)));
-		isoOffset.x -= static_cast<float>(y * (m_tileWidth / 2u));
-		isoOffset.y -= static_cast<float>(y * (m_tileHeight / 2u));
-		isoOffset.x -= static_cast<float>(m_tileWidth / 2u);
-		isoOffset.y += static_cast<float>(m_tileHeight / 2u);
-
-		v0.position += isoOffset;
-		v1.position += isoOffset;
-		v2.position += isoOffset;
-		v3.position += isoOffset;
+		isoOffset.x = -static_cast<float>(x * (m_tileWidth / 2u)) - static_cast<float>(y * (m_tileWidth / 2u)) - static_cast<float>(m_tileWidth / 2u);
+		isoOffset.y = static_cast<float>(x * (m_tileHeight / 2u)) - static_cast<float>(y * (m_tileHeight / 2u)) + static_cast<float>(m_tileHeight / 2u);
 	}
 
-	v0.color = colour;
-	v1.color = colour;
-	v2.color = colour;
-	v3.color = colour;
-
-	v0.position += offset;
-	v1.position += offset;
-	v2.position += offset;
-	v3.position += offset;
-
-	sf::Uint16 id = m_tileInfo[gid].TileSetId;
-	if(layer.layerSets.find(id) == layer.layerSets.end())
+	const sf::Color colour(255u, 255u, 255u, static_cast<sf::Uint8>(255.f * layer.opacity));
+	for(auto i = 0u; i < 4u; ++i)
 	{
-		//create a new layerset for texture
-		layer.layerSets.insert(std::make_pair(id, std::make_shared<LayerSet>(*m_tilesetTextures[id], m_patchSize, sf::Vector2u(m_width, m_height), sf::Vector2u(m_tileWidth, m_tileHeight))));
+		vertices[i].position += isoOffset + offset;
+		vertices[i].texCoords = info.TexCoords[flips][i];
+		vertices[i].color = colour;
 	}
 
 	//add tile to set
-	return layer.layerSets[id]->addTile(v0, v1, v2, v3, x, y);
+	LayerSet& layerSet = getLayerSet(layer, info.TileSetId);
+	TileQuad* quad = layerSet.addTile(vertices[0], vertices[1], vertices[2], vertices[3], x, y);
+	if(info.AnimationId > -1)
+		layerSet.animateLastTile(m_animationFrames, info.AnimationId, m_flipCorners[flips]);
+
+	return quad;
 }
 
 bool MapLoader::parseObjectgroup(const pugi::xml_node& groupNode)
@@ -752,9 +1076,11 @@ bool MapLoader::parseObjectgroup(const pugi::xml_node& groupNode)
 
 	//add layer to map layers
 	MapLayer layer(ObjectGroup);
+	layer.patchInfo.patchSize = m_patchSize;
 
 	layer.name = groupNode.attribute("name").as_string();
 	if(groupNode.attribute("opacity")) layer.opacity = groupNode.attribute("opacity").as_float();
+	parseLayerTransform(groupNode, layer);
 	if(pugi::xml_node propertiesNode = groupNode.child("properties"))
 		parseLayerProperties(propertiesNode, layer);
 	//NOTE we push the layer onto the vector at the end of the function in case we add any objects
@@ -884,17 +1210,19 @@ bool MapLoader::parseObjectgroup(const pugi::xml_node& groupNode)
 		{		
 			sf::Uint32 gid = objectNode.attribute("gid").as_int();
 
-			LOG("Found object with tile GID " + gid, Logger::Type::Info);
+			LOG("Found object with tile GID " + std::to_string(gid), Logger::Type::Info);
 
 			object.move(0.f, static_cast<float>(-m_tileHeight)); //offset for tile origins being at the bottom in Tiled
-			const sf::Uint16 x = static_cast<sf::Uint16>(object.getPosition().x / m_tileWidth);
-			const sf::Uint16 y = static_cast<sf::Uint16>(object.getPosition().y / m_tileHeight);
+			const sf::Vector2f stride = getCellStride();
+			const sf::Uint16 x = static_cast<sf::Uint16>(object.getPosition().x / stride.x);
+			const sf::Uint16 y = static_cast<sf::Uint16>(object.getPosition().y / stride.y);
 			
-			sf::Vector2f offset(object.getPosition().x - (x * m_tileWidth), (object.getPosition().y - (y * m_tileHeight)));
+			sf::Vector2f offset(object.getPosition().x - (x * stride.x), (object.getPosition().y - (y * stride.y)));
 			object.setQuad(addTileToLayer(layer, x, y, gid, offset));
 			object.setShapeType(Tile);
 
-			TileInfo info = m_tileInfo[gid];
+			const sf::Uint32 id = gid & ~FLIP_FLAGS;
+			const TileInfo& info = m_tileInfo[(id < m_tileInfo.size()) ? id : 0u];
 			//create bounding poly
 			float width = static_cast<float>(info.Size.x);
 			float height = static_cast<float>(info.Size.y);
@@ -978,6 +1306,7 @@ bool MapLoader::parseImageLayer(const pugi::xml_node& imageLayerNode)
 		tile.sprite.setColor(sf::Color(255u, 255u, 255u, opacity));
 	}
 	layer.tiles.push_back(tile);
+	parseLayerTransform(imageLayerNode, layer);
 
 	//parse layer properties
 	if(pugi::xml_node propertiesNode = imageLayerNode.child("properties"))
@@ -989,6 +1318,15 @@ bool MapLoader::parseImageLayer(const pugi::xml_node& imageLayerNode)
 	return true;
 }
 
+void MapLoader::parseLayerTransform(const pugi::xml_node& layerNode, MapLayer& layer)
+{
+	//applied when drawing rather than to the vertices, so parallax layers can scroll freely
+	layer.offset.x = layerNode.attribute("offsetx").as_float();
+	layer.offset.y = layerNode.attribute("offsety").as_float();
+	layer.parallaxFactor.x = layerNode.attribute("parallaxx").as_float(1.f);
+	layer.parallaxFactor.y = layerNode.attribute("parallaxy").as_float(1.f);
+}
+
 void MapLoader::parseLayerProperties(const pugi::xml_node& propertiesNode, MapLayer& layer)
 {
 	pugi::xml_node propertyNode = propertiesNode.child("property");
@@ -1002,6 +1340,13 @@ void MapLoader::parseLayerProperties(const pugi::xml_node& propertiesNode, MapLa
 	}
 }
 
+bool MapLoader::isStaticLayer(const MapLayer& layer)
+{
+	if(layer.type != ObjectGroup) return false;
+	auto result = layer.properties.find("static");
+	return (result != layer.properties.end() && (result->second == "true" || result->second == "1"));
+}
+
 void MapLoader::createDebugGrid()
 {
 	sf::Color debugColour(0u, 0u, 0u, 120u);
@@ -1051,8 +1396,8 @@ void MapLoader::drawLayer(sf::RenderTarget& rt, MapLayer& layer, bool debug)
 	if(debug && layer.type == ObjectGroup)
 	{
 		for(const auto& object : layer.objects)		
-			if(m_bounds.intersects(object.getAABB()))
-				object.drawDebugShape(rt);
+			if(m_bounds.intersects(layer.getTransform().transformRect(object.getAABB())))
+				object.drawDebugShape(rt, layer.getTransform());
 	}
 }
 
@@ -1073,29 +1418,93 @@ std::string MapLoader::fileFromPath(const std::string& path)
 
 void MapLoader::draw(sf::RenderTarget& rt, sf::RenderStates /* states */) const
 {
-	sf::View view  = rt.getView();
-	if(view.getCenter() != m_lastViewPos)
+	sf::Clock clock;
+	setDrawingBounds(rt);
+	m_renderStats.cullTime = clock.restart();
+
+	for(auto& layer : m_layers)
+		rt.draw(layer);
+	m_renderStats.drawTime = clock.getElapsedTime();
+
+	updateRenderStats();
+}
+
+void MapLoader::updateRenderStats() const
+{
+	//resizing reuses the existing storage so this doesn't allocate every frame
+	m_renderStats.total = RenderStats::Counters();
+	m_renderStats.layers.resize(m_layers.size());
+	for(auto i = 0u; i < m_layers.size(); ++i)
 	{
-		sf::FloatRect bounds;
-		bounds.left = view.getCenter().x - (view.getSize().x / 2.f);
-		bounds.top = view.getCenter().y - (view.getSize().y / 2.f);
-		bounds.width = view.getSize().x;
-		bounds.height = view.getSize().y;
+		updateLayerStats(static_cast<sf::Uint16>(i));
+		m_renderStats.total += m_renderStats.layers[i].counters;
+	}
+}
 
-		//add a tile border to prevent gaps appearing
-		bounds.left -= static_cast<float>(m_tileWidth);
-		bounds.top -= static_cast<float>(m_tileHeight);
-		bounds.width += static_cast<float>(m_tileWidth * 2);
-		bounds.height += static_cast<float>(m_tileHeight * 2);
-		m_bounds = bounds;
+void MapLoader::updateRenderStats(sf::Uint16 index) const
+{
+	//the other layers keep the counters from when they were last drawn
+	m_renderStats.layers.resize(m_layers.size());
+	updateLayerStats(index);
 
-		for(auto& layer : m_layers)
-			layer.cull(m_bounds);
+	m_renderStats.total = RenderStats::Counters();
+	for(const auto& layerStats : m_renderStats.layers)
+		m_renderStats.total += layerStats.counters;
+}
+
+void MapLoader::updateLayerStats(sf::Uint16 index) const
+{
+	const auto& layer = m_layers[index];
+	auto& layerStats = m_renderStats.layers[index];
+	layerStats.counters = RenderStats::Counters();
+	layerStats.layerSets.resize(layer.layerSets.size());
+
+	auto j = 0u;
+	for(const auto& ls : layer.layerSets)
+	{
+		//invisible layers skip drawing so their sets hold stale values
+		layerStats.layerSets[j] = (layer.visible) ? ls.second->getStats() : RenderStats::Counters();
+		layerStats.counters += layerStats.layerSets[j++];
 	}
-	m_lastViewPos = view.getCenter();
 
-	for(auto& layer : m_layers)
-		rt.draw(layer);
+	if(layer.visible && layer.type == ImageLayer)
+	{
+		layerStats.counters.drawCalls += static_cast<sf::Uint32>(layer.tiles.size());
+		layerStats.counters.vertices += static_cast<sf::Uint32>(layer.tiles.size() * 4u);
+	}
+}
+
+void MapLoader::drawRenderStats(sf::RenderTarget& rt) const
+{
+	std::stringstream ss;
+	ss << "Draw calls: " << m_renderStats.total.drawCalls
+		<< "\nVertices: " << m_renderStats.total.vertices
+		<< "\nPatches visible: " << m_renderStats.total.visiblePatches
+		<< " culled: " << m_renderStats.total.culledPatches
+		<< "\nLOD chunks: " << m_renderStats.total.lodChunks
+		<< "\nDirty quads: " << m_renderStats.total.dirtyQuads
+		<< " animated: " << m_renderStats.total.animatedQuads
+		<< "\nCull time: " << m_renderStats.cullTime.asMicroseconds() << "us"
+		<< "\nDraw time: " << m_renderStats.drawTime.asMicroseconds() << "us";
+
+	for(auto i = 0u; i < m_renderStats.layers.size() && i < m_layers.size(); ++i)
+	{
+		const auto& counters = m_renderStats.layers[i].counters;
+		if(counters.drawCalls == 0u && counters.culledPatches == 0u) continue;
+
+		ss << "\n  " << m_layers[i].name << ": " << counters.drawCalls << " calls, "
+			<< counters.visiblePatches << "/" << (counters.visiblePatches + counters.culledPatches) << " patches";
+		if(counters.lodChunks > 0u) ss << ", " << counters.lodChunks << " LOD chunks";
+	}
+
+	sf::Text text(ss.str(), *m_debugFont, 14u);
+	text.setPosition(8.f, 8.f);
+
+	//draw in screen space so the text isn't moved or scaled by the map view
+	const sf::View view = rt.getView();
+	rt.setView(rt.getDefaultView());
+	rt.draw(text);
+	rt.setView(view);
 }
 
 //decoding and utility functions
@@ -1132,7 +1541,30 @@ bool MapLoader::decompress(const char* source, std::vector<unsigned char>& dest,
 	stream.next_out = (Bytef*)byteArray.data();
 	stream.avail_out = expectedSize;
 
-	if(inflateInit(&stream/*, 15 + 32*/) != Z_OK)
+	//miniz only understands zlib headers, so skip any gzip header and
+	//trailer and inflate the raw deflate stream between them
+	int windowBits = MZ_DEFAULT_WINDOW_BITS;
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(source);
+	if(inSize > 18 && bytes[0] == 0x1f && bytes[1] == 0x8b)
+	{
+		const unsigned char flags = bytes[3];
+		int headerSize = 10;
+		if(flags & 0x04) headerSize += 2 + (bytes[10] | (bytes[11] << 8)); //extra field
+		if(flags & 0x08) while(headerSize < inSize && bytes[headerSize++] != 0); //file name
+		if(flags & 0x10) while(headerSize < inSize && bytes[headerSize++] != 0); //comment
+		if(flags & 0x02) headerSize += 2; //header crc
+
+		if(headerSize + 8 > inSize)
+		{
+			LOG("Invalid gzip header.", Logger::Type::Error);
+			return false;
+		}
+		stream.next_in = (Bytef*)(bytes + headerSize);
+		stream.avail_in = inSize - headerSize - 8; //crc32 and size trailer
+		windowBits = -MZ_DEFAULT_WINDOW_BITS;
+	}
+
+	if(inflateInit2(&stream, windowBits) != Z_OK)
 	{
 		LOG("inflate init failed", Logger::Type::Error);
 		return false;
@@ -28,28 +28,60 @@ it freely, subject to the following restrictions:
 
 #include <tmx/MapLoader.hpp>
 #include <tmx/Log.hpp>
+#include <tmx/Helpers.hpp>
+#include <tmx/SmallHeap.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <limits>
 
 using namespace tmx;
 
+namespace
+{
+	//spreads the lower 16 bits of a value over the even bits
+	sf::Uint32 spreadBits(sf::Uint32 value)
+	{
+		value &= 0xffff;
+		value = (value | (value << 8u)) & 0x00ff00ff;
+		value = (value | (value << 4u)) & 0x0f0f0f0f;
+		value = (value | (value << 2u)) & 0x33333333;
+		value = (value | (value << 1u)) & 0x55555555;
+		return value;
+	}
+}
+
 //ctor
 MapLoader::MapLoader(const std::string& mapDirectory, sf::Uint8 patchSize)
 	: m_width			(1u),
 	m_height			(1u),
 	m_tileWidth			(1u),
 	m_tileHeight		(1u),
+	m_orientation		(MapOrientation::Orthogonal),
 	m_tileRatio			(1.f),
+	m_staggerX			(false),
+	m_staggerEven		(false),
+	m_hexSideLength		(0u),
 	m_patchSize			(patchSize),
+	m_autoPatchSize		(false),
+	m_expectedViewSize	(1280.f, 720.f),
+	m_lodLevelCount		(0u),
+	m_depthSorting		(false),
+	m_minTexelDensity	(1.f),
+	m_tileOverhang		(0.f),
+	m_debugFont			(nullptr),
 	m_mapLoaded			(false),
 	m_quadTreeAvailable	(false),
+	m_quadTreeAutoTune	(false),
+	m_spatialIndex		(SpatialIndex::QuadTree),
+	m_nextSpatialIndex	(SpatialIndex::QuadTree),
 	m_failedImage		(false)
 {
 	//reserve some space to help reduce reallocations
 	m_layers.reserve(10);
 	addSearchPath(mapDirectory);
+	createFlipCorners();
 
-	assert(patchSize > 0);
 }
 
 bool MapLoader::load(const std::string& map)
@@ -100,24 +132,332 @@ void MapLoader::addSearchPath(const std::string& path)
 	else if(s == "/" || s == "\\") s = "";
 }
 
+void MapLoader::update(sf::Time dt)
+{
+	m_animationTime += dt;
+	const sf::Int64 time = m_animationTime.asMicroseconds();
+
+	for(auto i = 0u; i < m_animations.size(); ++i)
+	{
+		const auto& animation = m_animations[i];
+		sf::Int64 position = time % animation.duration;
+		sf::Uint32 frame = 0u;
+		while(position >= animation.frames[frame].second)
+		{
+			position -= animation.frames[frame].second;
+			frame++;
+		}
+
+		//layer sets rewrite their quads when they see the index change
+		if(frame != m_animationFrames[i].index)
+			setAnimationFrame(i, frame);
+	}
+}
+
 void MapLoader::updateQuadTree(const sf::FloatRect& rootArea)
 {
-	m_rootNode.clear(rootArea);
+	//objects from non static layers, less any removed with removeObject(), and those added with addObject()
+	auto& objects = m_treeObjects;
+	objects.clear();
 	for(const auto& layer : m_layers)
 	{
+		if(isStaticLayer(layer)) continue;
 		for(const auto& object : layer.objects)
 		{
-			m_rootNode.insert(object);
+			if(m_removedObjects.count(&object) == 0u)
+				objects.push_back(&object);
 		}
 	}
+	objects.insert(objects.end(), m_addedObjects.begin(), m_addedObjects.end());
+
+	m_spatialIndex = m_nextSpatialIndex;
+	if(m_spatialIndex == SpatialIndex::Grid)
+	{
+		const sf::Vector2f tileSize(static_cast<float>(m_tileWidth), static_cast<float>(m_tileHeight));
+		m_grid.setCellSize((m_gridCellSize.x > 0.f && m_gridCellSize.y > 0.f) ? m_gridCellSize : tileSize * 2.f);
+		m_grid.clear(rootArea);
+		for(auto object : objects)
+			m_grid.insert(*object);
+		m_quadTreeAvailable = true;
+		return;
+	}
+
+	m_rootNode.clear(rootArea);
+	if(m_quadTreeAutoTune)
+	{
+		std::vector<sf::FloatRect> objectBounds;
+		for(auto object : objects)
+			objectBounds.push_back(object->getAABB());
+		m_rootNode.setSettings(QuadTreeRoot::autoTune(rootArea, objectBounds));
+	}
+
+	for(auto object : objects)
+		m_rootNode.insert(*object);
 	m_quadTreeAvailable = true;
 }
 
-std::vector<MapObject*> MapLoader::queryQuadTree(const sf::FloatRect& testArea)
+void MapLoader::setSpatialIndex(SpatialIndex index, const sf::Vector2f& cellSize)
+{
+	m_nextSpatialIndex = index;
+	m_gridCellSize = cellSize;
+}
+
+void MapLoader::updateQuadTree(const MapObject& object)
+{
+	assert(m_quadTreeAvailable);
+	if(m_staticTree.contains(object)) return;
+
+	if(m_spatialIndex == SpatialIndex::Grid)
+		m_grid.update(object);
+	else
+		m_rootNode.update(object);
+}
+
+std::vector<MapObject*> MapLoader::queryQuadTree(const sf::FloatRect& testArea) const
 {
 	//quad tree must be updated at least once with UpdateQuadTree before we can call this
 	assert(m_quadTreeAvailable);
-	return m_rootNode.retrieve(testArea);
+	std::vector<MapObject*> foundObjects = (m_spatialIndex == SpatialIndex::Grid) ? m_grid.retrieve(testArea) : m_rootNode.retrieve(testArea);
+	m_staticTree.retrieve(testArea, foundObjects);
+	return foundObjects;
+}
+
+void MapLoader::queryQuadTree(const sf::FloatRect& testArea, std::vector<MapObject*>& results, SpatialQuery query, SpatialQueryStats* stats) const
+{
+	assert(m_quadTreeAvailable);
+	results.clear();
+	if(m_spatialIndex == SpatialIndex::Grid)
+		m_grid.retrieve(testArea, results, query, stats);
+	else
+		m_rootNode.retrieve(testArea, results, query, stats);
+	m_staticTree.retrieve(testArea, results, query, stats);
+}
+
+void MapLoader::queryQuadTree(const sf::FloatRect* areas, std::size_t count, BatchQueryResults& results, SpatialQuery query, sf::Uint32 threadCount) const
+{
+	assert(m_quadTreeAvailable);
+	results.offsets.assign(1u, 0u);
+	results.objects.clear();
+	if(count == 0u) return;
+
+	//quantise the centre of each area within the bounds of all of them, to find its Morton code
+	sf::Vector2f min(areas[0].left + areas[0].width / 2.f, areas[0].top + areas[0].height / 2.f);
+	sf::Vector2f max = min;
+	for(auto i = 1u; i < count; ++i)
+	{
+		const sf::Vector2f centre(areas[i].left + areas[i].width / 2.f, areas[i].top + areas[i].height / 2.f);
+		min.x = std::min(min.x, centre.x);
+		min.y = std::min(min.y, centre.y);
+		max.x = std::max(max.x, centre.x);
+		max.y = std::max(max.y, centre.y);
+	}
+	const sf::Vector2f scale((max.x > min.x) ? 65535.f / (max.x - min.x) : 0.f, (max.y > min.y) ? 65535.f / (max.y - min.y) : 0.f);
+
+	results.m_order.resize(count);
+	for(auto i = 0u; i < count; ++i)
+	{
+		const sf::Vector2f centre(areas[i].left + areas[i].width / 2.f, areas[i].top + areas[i].height / 2.f);
+		const sf::Uint32 x = static_cast<sf::Uint32>((centre.x - min.x) * scale.x);
+		const sf::Uint32 y = static_cast<sf::Uint32>((centre.y - min.y) * scale.y);
+		results.m_order[i] = std::make_pair(spreadBits(x) | (spreadBits(y) << 1u), static_cast<sf::Uint32>(i));
+	}
+	std::sort(results.m_order.begin(), results.m_order.end());
+
+	//each thread runs a consecutive run of queries, in Morton order
+	threadCount = static_cast<sf::Uint32>(std::max(std::size_t(1u), std::min(static_cast<std::size_t>(threadCount), count)));
+	results.m_threadObjects.resize(threadCount);
+	results.m_ranges.resize(count);
+	m_workers.run(threadCount, count, [this, areas, query, &results](sf::Uint32 thread, std::size_t first, std::size_t last)
+	{
+		auto& found = results.m_threadObjects[thread];
+		found.clear();
+		for(auto i = first; i < last; ++i)
+		{
+			const sf::Uint32 index = results.m_order[i].second;
+			const std::size_t start = found.size();
+			visitQuadTree(areas[index], [&found](MapObject* object)
+			{
+				found.push_back(object);
+			}, query);
+			results.m_ranges[index] = { thread, static_cast<sf::Uint32>(start), static_cast<sf::Uint32>(found.size() - start) };
+		}
+	});
+
+	//gather the objects back into the order the areas were given
+	results.offsets.resize(count + 1u);
+	for(auto i = 0u; i < count; ++i)
+		results.offsets[i + 1u] = results.offsets[i] + results.m_ranges[i].count;
+	results.objects.resize(results.offsets.back());
+	for(auto i = 0u; i < count; ++i)
+	{
+		const auto& range = results.m_ranges[i];
+		const auto& found = results.m_threadObjects[range.thread];
+		std::copy(found.begin() + range.start, found.begin() + range.start + range.count, results.objects.begin() + results.offsets[i]);
+	}
+}
+
+bool MapLoader::raycast(const sf::Vector2f& start, const sf::Vector2f& end, RaycastHit& hit) const
+{
+	assert(m_quadTreeAvailable);
+	float fraction = 1.f;
+	sf::Vector2f normal;
+	MapObject* nearest = nullptr;
+	visitRay(start, end, [&](MapObject* object)
+	{
+		if(object->raycast(start, end, fraction, normal))
+			nearest = object;
+	}, fraction);
+	if(!nearest) return false;
+
+	hit.object = nearest;
+	hit.point = start + (end - start) * fraction;
+	hit.distance = Helpers::Vectors::getLength(end - start) * fraction;
+	hit.normal = normal;
+	return true;
+}
+
+bool MapLoader::lineOfSight(const sf::Vector2f& start, const sf::Vector2f& end) const
+{
+	assert(m_quadTreeAvailable);
+	float fraction = 1.f;
+	sf::Vector2f normal;
+	bool blocked = false;
+	visitRay(start, end, [&](MapObject* object)
+	{
+		//any hit will do, so skip everything else once one is found
+		if(object->raycast(start, end, fraction, normal))
+		{
+			blocked = true;
+			fraction = 0.f;
+		}
+	}, fraction);
+	return !blocked;
+}
+
+void MapLoader::lineOfSight(const sf::Vector2f* starts, const sf::Vector2f* ends, std::size_t count, std::vector<sf::Uint8>& results, sf::Uint32 threadCount) const
+{
+	results.resize(count);
+	threadCount = static_cast<sf::Uint32>(std::max(std::size_t(1u), std::min(static_cast<std::size_t>(threadCount), count)));
+	m_workers.run(threadCount, count, [this, starts, ends, &results](sf::Uint32, std::size_t first, std::size_t last)
+	{
+		for(auto i = first; i < last; ++i)
+			results[i] = lineOfSight(starts[i], ends[i]) ? 1u : 0u;
+	});
+}
+
+void MapLoader::nearest(const sf::Vector2f& point, std::size_t k, std::vector<MapObject*>& results, const ObjectFilter& filter) const
+{
+	assert(m_quadTreeAvailable);
+	results.clear();
+	if(k == 0u) return;
+
+	//the nearest objects found so far, with the furthest on top
+	using Entry = std::pair<float, MapObject*>;
+	SmallHeap<Entry, 16u> found;
+	float maxDistance = std::numeric_limits<float>::infinity();
+	visitNearby(point, [&](MapObject* object)
+	{
+		if(filter && !filter(*object)) return;
+
+		const float distance = object->distanceTo(point);
+		if(distance >= maxDistance) return;
+
+		if(found.size() == k) found.pop();
+		found.push(std::make_pair(distance, object));
+
+		//once k objects are found only nearer ones are of interest
+		if(found.size() == k) maxDistance = found.top().first;
+	}, maxDistance);
+
+	//the furthest come off the heap first
+	results.resize(found.size());
+	for(auto i = results.size(); i > 0u; --i)
+	{
+		results[i - 1u] = found.top().second;
+		found.pop();
+	}
+}
+
+std::vector<MapObject*> MapLoader::nearest(const sf::Vector2f& point, std::size_t k, const ObjectFilter& filter) const
+{
+	std::vector<MapObject*> results;
+	nearest(point, k, results, filter);
+	return results;
+}
+
+void MapLoader::withinRadius(const sf::Vector2f& point, float radius, std::vector<MapObject*>& results, const ObjectFilter& filter) const
+{
+	assert(m_quadTreeAvailable);
+	results.clear();
+	visitNearby(point, [&](MapObject* object)
+	{
+		if((!filter || filter(*object)) && object->distanceTo(point) <= radius)
+			results.push_back(object);
+	}, radius);
+}
+
+std::vector<MapObject*> MapLoader::withinRadius(const sf::Vector2f& point, float radius, const ObjectFilter& filter) const
+{
+	std::vector<MapObject*> results;
+	withinRadius(point, radius, results, filter);
+	return results;
+}
+
+void MapLoader::objectsAt(const sf::Vector2f& point, std::vector<MapObject*>& results, const ObjectFilter& filter) const
+{
+	assert(m_quadTreeAvailable);
+	results.clear();
+	//a search distance of 0 only visits nodes and objects whose bounds contain the point
+	visitNearby(point, [&](MapObject* object)
+	{
+		if((!filter || filter(*object)) && object->contains(point))
+			results.push_back(object);
+	}, 0.f);
+}
+
+std::vector<MapObject*> MapLoader::objectsAt(const sf::Vector2f& point, const ObjectFilter& filter) const
+{
+	std::vector<MapObject*> results;
+	objectsAt(point, results, filter);
+	return results;
+}
+
+void MapLoader::addObject(MapObject& object)
+{
+	if(!m_objectIndex.contains(object))
+	{
+		//objects from the map's layers which were removed are already stored
+		if(m_removedObjects.erase(&object) == 0u)
+			m_addedObjects.push_back(&object);
+	}
+	m_objectIndex.insert(object);
+
+	if(m_quadTreeAvailable) updateQuadTree(object);
+}
+
+bool MapLoader::removeObject(const MapObject& object)
+{
+	if(m_staticTree.contains(object))
+	{
+		LOG("Objects on static layers can't be removed.", Logger::Type::Warning);
+		return false;
+	}
+	if(!m_objectIndex.remove(object)) return false;
+
+	auto result = std::find(m_addedObjects.begin(), m_addedObjects.end(), &object);
+	if(result != m_addedObjects.end())
+		m_addedObjects.erase(result);
+	else
+		m_removedObjects.insert(&object);
+
+	if(m_quadTreeAvailable)
+	{
+		if(m_spatialIndex == SpatialIndex::Grid)
+			m_grid.remove(object);
+		else
+			m_rootNode.remove(object);
+	}
+	return true;
 }
 
 std::vector<MapLayer>& MapLoader::getLayers()
@@ -132,47 +472,65 @@ const std::vector<MapLayer>& MapLoader::getLayers() const
 
 void MapLoader::drawLayer(sf::RenderTarget& rt, MapLayer::DrawType type, bool debug)
 {
-	setDrawingBounds(rt.getView());
+	if(type != MapLayer::Back && type != MapLayer::Front && type != MapLayer::Debug)
+	{
+		//same as drawing the map directly, which also updates the render stats
+		draw(rt, sf::RenderStates::Default);
+		return;
+	}
+
+	setDrawingBounds(rt);
 	switch(type)
 	{
 	default:
-	case MapLayer::All:
-		for(const auto& l : m_layers)
-			rt.draw(l);
-		break;
 	case MapLayer::Back:
 		{
 		//remember front of vector actually draws furthest back
 		MapLayer& layer = m_layers.front();
 		drawLayer(rt, layer, debug);
+		updateRenderStats(0u);
 		}
 		break;
 	case MapLayer::Front:
 		{
 		MapLayer& layer = m_layers.back();
 		drawLayer(rt, layer, debug);
+		updateRenderStats(static_cast<sf::Uint16>(m_layers.size() - 1u));
 		}
 		break;
 	case MapLayer::Debug:
-		for(auto layer : m_layers)
+		for(const auto& layer : m_layers)
 		{
 			if(layer.type == ObjectGroup)
 			{
 				for(const auto& object : layer.objects)
-					if (m_bounds.intersects(object.getAABB()))
-						object.drawDebugShape(rt);
+					if (m_bounds.intersects(layer.getTransform().transformRect(object.getAABB())))
+						object.drawDebugShape(rt, layer.getTransform());
 			}
 		}
 		rt.draw(m_gridVertices);
-		rt.draw(m_rootNode);
+		if(m_spatialIndex == SpatialIndex::Grid)
+			rt.draw(m_grid);
+		else
+			rt.draw(m_rootNode);
+		rt.draw(m_staticTree);
+		if(m_debugFont) drawRenderStats(rt);
 		break;
 	}
 }
 
 void MapLoader::drawLayer(sf::RenderTarget& rt, sf::Uint16 index, bool debug)
 {
-	setDrawingBounds(rt.getView());
+	setDrawingBounds(rt);
 	drawLayer(rt, m_layers[index], debug);
+	updateRenderStats(index);
+}
+
+void MapLoader::drawLayer(sf::RenderTarget& rt, sf::Uint16 index, const DepthSorter& drawables)
+{
+	setDrawingBounds(rt);
+	m_layers[index].drawSorted(rt, drawables);
+	updateRenderStats(index);
 }
 
 sf::Vector2f MapLoader::isometricToOrthogonal(const sf::Vector2f& projectedCoords)
@@ -198,9 +556,25 @@ sf::Vector2u MapLoader::getTileSize() const
 
 sf::Vector2u MapLoader::getMapSize() const
 {
+	if(m_orientation == MapOrientation::SteppedIsometric || m_orientation == MapOrientation::Hexagonal)
+	{
+		//the last cell overhangs its stride, and staggered cells overhang the opposite edge
+		const sf::Vector2f stride = getCellStride();
+		const sf::Vector2f stagger = getStaggerOffset();
+		sf::Vector2f size(stride.x * m_width + (static_cast<float>(m_tileWidth & ~1) - stride.x),
+			stride.y * m_height + (static_cast<float>(m_tileHeight & ~1) - stride.y));
+		if(m_staggerX && m_width > 1) size.y += stagger.y;
+		if(!m_staggerX && m_height > 1) size.x += stagger.x;
+		return sf::Vector2u(size);
+	}
 	return sf::Vector2u(m_width * m_tileWidth, m_height * m_tileHeight);
 }
 
+MapOrientation MapLoader::getOrientation() const
+{
+	return m_orientation;
+}
+
 std::string MapLoader::getPropertyString(const std::string& name)
 {
 	assert(m_properties.find(name) != m_properties.end());
@@ -217,20 +591,84 @@ bool MapLoader::quadTreeAvailable() const
 	return m_quadTreeAvailable;
 }
 
+void MapLoader::setQuadTreeSettings(const QuadTreeRoot::Settings& settings)
+{
+	m_quadTreeAutoTune = false;
+	m_rootNode.setSettings(settings);
+}
+
+void MapLoader::setQuadTreeAutoTune(bool enabled)
+{
+	m_quadTreeAutoTune = enabled;
+}
+
+QuadTreeRoot::Stats MapLoader::getQuadTreeStats() const
+{
+	//the tree isn't rebuilt while the grid is in use, so its stats would be stale
+	if(m_spatialIndex == SpatialIndex::Grid) return QuadTreeRoot::Stats();
+	return m_rootNode.getStats();
+}
+
+void MapLoader::setAutoPatchSize(bool enabled, const sf::Vector2f& expectedViewSize)
+{
+	assert(expectedViewSize.x > 0.f && expectedViewSize.y > 0.f);
+	m_autoPatchSize = enabled;
+	m_expectedViewSize = expectedViewSize;
+}
+
+const RenderStats& MapLoader::getRenderStats() const
+{
+	return m_renderStats;
+}
+
+void MapLoader::setDebugFont(const sf::Font& font)
+{
+	m_debugFont = &font;
+}
+
+void MapLoader::setLevelOfDetail(sf::Uint8 levels, float minTexelDensity)
+{
+	assert(minTexelDensity > 0.f);
+	m_lodLevelCount = std::min(levels, LayerSet::maxLodLevels);
+	m_minTexelDensity = minTexelDensity;
+}
+
+void MapLoader::setDepthSorting(bool enabled)
+{
+	m_depthSorting = enabled;
+}
+
 
 
 MapLoader::TileInfo::TileInfo()
-	: TileSetId (0u)
+	: TileSetId (0u),
+	AnimationId	(-1)
 {
 
 }
 
-MapLoader::TileInfo::TileInfo(const sf::IntRect& rect, const sf::Vector2f& size, sf::Uint16 tilesetId)
+MapLoader::TileInfo::TileInfo(const sf::IntRect& rect, const sf::Vector2f& size, sf::Uint16 tilesetId, const FlipCorners& flipCorners)
 	: Size		(size),
-	TileSetId	(tilesetId)
+	TileSetId	(tilesetId),
+	AnimationId	(-1)
 {
 	Coords[0] = sf::Vector2f(static_cast<float>(rect.left), static_cast<float>(rect.top));
 	Coords[1] = sf::Vector2f(static_cast<float>(rect.left + rect.width), static_cast<float>(rect.top));
 	Coords[2] = sf::Vector2f(static_cast<float>(rect.left + rect.width), static_cast<float>(rect.top + rect.height));
 	Coords[3] = sf::Vector2f(static_cast<float>(rect.left), static_cast<float>(rect.top + rect.height));
+
+	//applying half pixel trick avoids artifacting when scrolling
+	const std::array<sf::Vector2f, 4u> inset = 
+	{{
+		Coords[0] + sf::Vector2f(0.5f, 0.5f),
+		Coords[1] + sf::Vector2f(-0.5f, 0.5f),
+		Coords[2] + sf::Vector2f(-0.5f, -0.5f),
+		Coords[3] + sf::Vector2f(0.5f, -0.5f)
+	}};
+
+	for(auto i = 0u; i < flipCorners.size(); ++i)
+	{
+		for(auto j = 0u; j < 4u; ++j)
+			TexCoords[i][j] = inset[flipCorners[i][j]];
+	}
 }
\ No newline at end of file
@@ -29,6 +29,9 @@ it freely, subject to the following restrictions:
 #include <tmx/MapLayer.hpp>
 #include <tmx/Log.hpp>
 
+#include <algorithm>
+#include <cmath>
+
 using namespace tmx;
 
 ///--------poly segment--------///
@@ -100,18 +103,37 @@ bool MapObject::contains(sf::Vector2f point) const
 	//check if enough poly points
 	if(m_polypoints.size() < 3) return false;
 
-	//else raycast through points - assuming given point is in world coords
-    const auto& transform = getTransform();
-	unsigned int i, j;
+	//points added since the last call to createDebugShape() haven't been oriented
+	if(m_orientedPoints.size() != m_polypoints.size())
+	{
+		const auto& transform = getTransform();
+		unsigned int i, j;
+		bool result = false;
+		for (i = 0, j = m_polypoints.size() - 1; i < m_polypoints.size(); j = i++)
+		{
+			sf::Vector2f pointI = transform.transformPoint(m_polypoints[i]);
+			sf::Vector2f pointJ = transform.transformPoint(m_polypoints[j]);
+
+			if (((pointI.y > point.y) != (pointJ.y > point.y)) &&
+				(point.x < (pointJ.x - pointI.x) * (point.y - pointI.y)
+				/ (pointJ.y - pointI.y) + pointI.x))
+					result = !result;
+		}
+		return result;
+	}
+
+	//else raycast through the oriented points, relative to the object's position
+	point -= getPosition();
+	if(point.x < m_orientedBounds.left || point.x > m_orientedBounds.left + m_orientedBounds.width
+		|| point.y < m_orientedBounds.top || point.y > m_orientedBounds.top + m_orientedBounds.height)
+		return false;
+
 	bool result = false;
-	for (i = 0, j = m_polypoints.size() - 1; i < m_polypoints.size(); j = i++)
+	for(std::size_t i = 0u, j = m_orientedPoints.size() - 1u; i < m_orientedPoints.size(); j = i++)
 	{
-        sf::Vector2f pointI = transform.transformPoint(m_polypoints[i]);
-        sf::Vector2f pointJ = transform.transformPoint(m_polypoints[j]);
-        
-        if (((pointI.y > point.y) != (pointJ.y > point.y)) &&
-            (point.x < (pointJ.x - pointI.x) * (point.y - pointI.y)
-            / (pointJ.y - pointI.y) + pointI.x))
+		const sf::Vector2f& pointI = m_orientedPoints[i];
+		if(((pointI.y > point.y) != (m_orientedPoints[j].y > point.y)) &&
+			(point.x < (point.y - pointI.y) * m_edgeSlopes[i] + pointI.x))
 				result = !result;
 	}
 	return result;
@@ -157,11 +179,13 @@ void MapObject::createDebugShape(const sf::Color& colour)
 
 	//create the AABB for quad tree testing
 	createAABB();
+
+	updateOrientedPoints();
 }
 
-void MapObject::drawDebugShape(sf::RenderTarget& rt) const
+void MapObject::drawDebugShape(sf::RenderTarget& rt, const sf::Transform& layerTransform) const
 {
-	rt.draw(m_debugShape, getTransform());
+	rt.draw(m_debugShape, layerTransform * getTransform());
 }
 
 sf::Vector2f MapObject::firstPoint() const
@@ -209,6 +233,66 @@ sf::Vector2f MapObject::collisionNormal(const sf::Vector2f& start, const sf::Vec
     return Helpers::Vectors::normalize(rv);
 }
 
+bool MapObject::raycast(const sf::Vector2f& start, const sf::Vector2f& end, float& fraction, sf::Vector2f& normal) const
+{
+	if(m_polypoints.size() < 2) return false;
+
+	const auto& transform = getTransform();
+	const sf::Vector2f direction = end - start;
+	const std::size_t edgeCount = (m_shape == Polyline) ? m_polypoints.size() - 1u : m_polypoints.size();
+	sf::Vector2f edgeStart = transform.transformPoint(m_polypoints[0]);
+	sf::Vector2f hitEdge;
+	bool hit = false;
+	for(auto i = 0u; i < edgeCount; ++i)
+	{
+		const sf::Vector2f edgeEnd = transform.transformPoint(m_polypoints[(i + 1u) % m_polypoints.size()]);
+		const sf::Vector2f edge = edgeEnd - edgeStart;
+		const float denominator = Helpers::Vectors::cross(direction, edge);
+		if(denominator != 0.f) //parallel edges can't be crossed
+		{
+			const sf::Vector2f offset = edgeStart - start;
+			const float t = Helpers::Vectors::cross(offset, edge) / denominator;
+			const float u = Helpers::Vectors::cross(offset, direction) / denominator;
+			if(t >= 0.f && t < fraction && u >= 0.f && u <= 1.f)
+			{
+				fraction = t;
+				hitEdge = edge;
+				hit = true;
+			}
+		}
+		edgeStart = edgeEnd;
+	}
+	if(!hit) return false;
+
+	normal = sf::Vector2f(hitEdge.y, -hitEdge.x);
+	if(Helpers::Vectors::dot(normal, direction) > 0.f) normal = -normal;
+	Helpers::Vectors::normalize(normal);
+	return true;
+}
+
+float MapObject::distanceTo(const sf::Vector2f& point) const
+{
+	if(m_polypoints.empty()) return Helpers::Vectors::getLength(point - getPosition());
+	if(contains(point)) return 0.f;
+
+	//else the distance to the nearest edge
+	const auto& transform = getTransform();
+	const std::size_t edgeCount = (m_shape == Polyline || m_polypoints.size() == 1u) ? m_polypoints.size() - 1u : m_polypoints.size();
+	sf::Vector2f edgeStart = transform.transformPoint(m_polypoints[0]);
+	float distanceSquared = Helpers::Vectors::getLengthSquared(point - edgeStart);
+	for(auto i = 0u; i < edgeCount; ++i)
+	{
+		const sf::Vector2f edgeEnd = transform.transformPoint(m_polypoints[(i + 1u) % m_polypoints.size()]);
+		const sf::Vector2f edge = edgeEnd - edgeStart;
+		const float lengthSquared = Helpers::Vectors::getLengthSquared(edge);
+		float t = (lengthSquared > 0.f) ? Helpers::Vectors::dot(point - edgeStart, edge) / lengthSquared : 0.f;
+		t = std::max(0.f, std::min(1.f, t));
+		distanceSquared = std::min(distanceSquared, Helpers::Vectors::getLengthSquared(point - (edgeStart + edge * t)));
+		edgeStart = edgeEnd;
+	}
+	return std::sqrt(distanceSquared);
+}
+
 void MapObject::createSegments()
 {
     if (m_polypoints.size() == 0)
@@ -261,6 +345,7 @@ const std::vector<sf::Vector2f>& MapObject::polyPoints()const
 void MapObject::reverseWinding()
 {
     std::reverse(m_polypoints.begin(), m_polypoints.end());
+    updateOrientedPoints();
 }
 
 void MapObject::setQuad(TileQuad* quad)
@@ -301,6 +386,52 @@ void MapObject::move(const sf::Vector2f& amount)
     move(amount.x, amount.y);
 }
 
+//and these so that the points used by contains() are reoriented
+void MapObject::setRotation(float angle)
+{
+    sf::Transformable::setRotation(angle);
+    updateOrientedPoints();
+}
+
+void MapObject::rotate(float angle)
+{
+    sf::Transformable::rotate(angle);
+    updateOrientedPoints();
+}
+
+void MapObject::setScale(float x, float y)
+{
+    sf::Transformable::setScale(x, y);
+    updateOrientedPoints();
+}
+
+void MapObject::setScale(const sf::Vector2f& factors)
+{
+    setScale(factors.x, factors.y);
+}
+
+void MapObject::scale(float x, float y)
+{
+    sf::Transformable::scale(x, y);
+    updateOrientedPoints();
+}
+
+void MapObject::scale(const sf::Vector2f& factors)
+{
+    scale(factors.x, factors.y);
+}
+
+void MapObject::setOrigin(float x, float y)
+{
+    sf::Transformable::setOrigin(x, y);
+    updateOrientedPoints();
+}
+
+void MapObject::setOrigin(const sf::Vector2f& origin)
+{
+    setOrigin(origin.x, origin.y);
+}
+
 //private
 sf::Vector2f MapObject::calcCentre() const
 {
@@ -392,4 +523,33 @@ void MapObject::createAABB()
 		//m_debugShape.append(sf::Vector2f(m_AABB.left + m_AABB.width, m_AABB.top + m_AABB.height));
 		//m_debugShape.append(sf::Vector2f(m_AABB.left, m_AABB.top + m_AABB.height));
 	}
+}
+
+void MapObject::updateOrientedPoints()
+{
+	m_orientedPoints.resize(m_polypoints.size());
+	m_edgeSlopes.resize(m_polypoints.size());
+	if(m_polypoints.empty()) return;
+
+	//the transform without its translation, so points stay valid when the object moves
+	const auto& transform = getTransform();
+	const sf::Vector2f position = getPosition();
+	for(auto i = 0u; i < m_polypoints.size(); ++i)
+		m_orientedPoints[i] = transform.transformPoint(m_polypoints[i]) - position;
+
+	sf::Vector2f min = m_orientedPoints[0];
+	sf::Vector2f max = m_orientedPoints[0];
+	for(std::size_t i = 0u, j = m_orientedPoints.size() - 1u; i < m_orientedPoints.size(); j = i++)
+	{
+		const sf::Vector2f& pointI = m_orientedPoints[i];
+		const sf::Vector2f& pointJ = m_orientedPoints[j];
+		//horizontal edges are never crossed by the test so their slope is unused
+		m_edgeSlopes[i] = (pointJ.y != pointI.y) ? (pointJ.x - pointI.x) / (pointJ.y - pointI.y) : 0.f;
+
+		min.x = std::min(min.x, pointI.x);
+		min.y = std::min(min.y, pointI.y);
+		max.x = std::max(max.x, pointI.x);
+		max.y = std::max(max.y, pointI.y);
+	}
+	m_orientedBounds = sf::FloatRect(min, max - min);
 }
\ No newline at end of file
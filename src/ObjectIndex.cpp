@@ -0,0 +1,117 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+Zlib License:
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+#include <tmx/ObjectIndex.hpp>
+
+#include <algorithm>
+
+using namespace tmx;
+
+//public
+void ObjectIndex::insert(MapObject& object)
+{
+	remove(object);
+
+	Keys& keys = m_keys[&object];
+	keys.name = object.getName();
+	keys.type = object.getType();
+	keys.properties = object.getProperties();
+
+	if(!keys.name.empty()) m_names[keys.name].push_back(&object);
+	if(!keys.type.empty()) m_types[keys.type].push_back(&object);
+	for(const auto& property : keys.properties)
+	{
+		PropertyBuckets& buckets = m_properties[property.first];
+		buckets.objects.push_back(&object);
+		buckets.values[property.second].push_back(&object);
+	}
+}
+
+bool ObjectIndex::remove(const MapObject& object)
+{
+	auto result = m_keys.find(&object);
+	if(result == m_keys.end()) return false;
+
+	const Keys& keys = result->second;
+	if(!keys.name.empty()) erase(m_names, keys.name, &object);
+	if(!keys.type.empty()) erase(m_types, keys.type, &object);
+	for(const auto& property : keys.properties)
+	{
+		auto buckets = m_properties.find(property.first);
+		assert(buckets != m_properties.end());
+		erase(buckets->second.values, property.second, &object);
+		erase(buckets->second.objects, &object);
+		if(buckets->second.objects.empty()) m_properties.erase(buckets);
+	}
+	m_keys.erase(result);
+	return true;
+}
+
+void ObjectIndex::clear()
+{
+	m_names.clear();
+	m_types.clear();
+	m_properties.clear();
+	m_keys.clear();
+}
+
+ObjectSpan ObjectIndex::findWithProperty(const std::string& name) const
+{
+	auto result = m_properties.find(name);
+	return (result == m_properties.end()) ? ObjectSpan() : ObjectSpan(result->second.objects);
+}
+
+ObjectSpan ObjectIndex::findByProperty(const std::string& name, const std::string& value) const
+{
+	auto result = m_properties.find(name);
+	return (result == m_properties.end()) ? ObjectSpan() : find(result->second.values, value);
+}
+
+//private
+ObjectSpan ObjectIndex::find(const BucketMap& buckets, const std::string& key)
+{
+	auto result = buckets.find(key);
+	return (result == buckets.end()) ? ObjectSpan() : ObjectSpan(result->second);
+}
+
+void ObjectIndex::erase(BucketMap& buckets, const std::string& key, const MapObject* object)
+{
+	auto result = buckets.find(key);
+	assert(result != buckets.end());
+	erase(result->second, object);
+	//empty buckets are dropped so that the maps don't grow as objects are renamed
+	if(result->second.empty()) buckets.erase(result);
+}
+
+void ObjectIndex::erase(Bucket& bucket, const MapObject* object)
+{
+	//keeps the remaining objects in the order they were inserted
+	auto result = std::find(bucket.begin(), bucket.end(), object);
+	assert(result != bucket.end());
+	bucket.erase(result);
+}
@@ -31,154 +31,324 @@ it freely, subject to the following restrictions:
 ///source for QuadTreeNode class///
 #include <tmx/QuadTreeNode.hpp>
 
+#include <algorithm>
+#include <cmath>
+
 using namespace tmx;
 
-namespace
+QuadTreeRoot::QuadTreeRoot(const sf::FloatRect& bounds)
+	: m_nodes		(1u),
+	m_nodeCount		(1u)
 {
-    //maximum objects per node before splitting
-    const sf::Uint16 MAX_OBJECTS = 5u;
-    //maximum number of levels to split
-    const sf::Uint16 MAX_LEVELS = 5u;
-}
-
-QuadTreeNode::QuadTreeNode(sf::Uint16 level, const sf::FloatRect& bounds)
-	: m_level		(level),
-	m_bounds		(bounds)
-{ 
-	m_children.reserve(4); 
+	m_nodes[0].bounds = bounds;
 }
 
 //public functions//
 void QuadTreeRoot::clear(const sf::FloatRect& newBounds)
 {
-	m_objects.clear();
-	m_children.clear();
-	m_bounds = newBounds;
+	//empty the nodes in use but keep their storage for the next rebuild
+	for(auto i = 0u; i < m_nodeCount; ++i)
+		m_nodes[i].objects.clear();
+	m_nodeCount = 1u;
+	m_freeNodes.clear();
+	m_locations.clear();
 
-	m_searchDepth = 0u;
-	m_depth = 0;
+	auto& root = m_nodes[0];
+	root.bounds = newBounds;
+	root.firstChild = -1;
 }
 
-std::vector<MapObject*> QuadTreeNode::retrieve(const sf::FloatRect& bounds, sf::Uint16& searchDepth)
-{	
-	searchDepth = m_level;
-	std::vector<MapObject*> foundObjects;
-	sf::Int16 index = getIndex(bounds);
+void QuadTreeRoot::insert(const MapObject& object)
+{
+	if(m_locations.find(&object))
+	{
+		update(object);
+		return;
+	}
+
+	//check if an object falls completely outside the tree
+	const sf::FloatRect aabb = object.getAABB();
+	if(!aabb.intersects(m_nodes[0].bounds)) return;
+
+	insert(0u, const_cast<MapObject*>(&object), aabb);
+}
+
+bool QuadTreeRoot::remove(const MapObject& object)
+{
+	const auto location = m_locations.find(&object);
+	if(!location) return false;
 
-	//recursively add objects of child node if bounds is fully contained
-	if(!m_children.empty() && index != -1) 
+	const sf::Uint32 nodeIndex = location->list;
+	const std::size_t slot = location->slot;
+	m_locations.erase(&object);
+	removeFromNode(nodeIndex, slot);
+	merge(nodeIndex);
+	return true;
+}
+
+void QuadTreeRoot::update(const MapObject& object)
+{
+	const auto location = m_locations.find(&object);
+	if(!location)
 	{
-		foundObjects = m_children[index]->retrieve(bounds, searchDepth);
+		insert(object);
+		return;
 	}
-	else
+
+	const sf::FloatRect aabb = object.getAABB();
+	if(!aabb.intersects(m_nodes[0].bounds))
 	{
-		//add all objects of child nodes which intersect test area
-		for(auto& child : m_children)
-		{
-			if(bounds.intersects(child->m_bounds))
-			{
-				std::vector<MapObject*> childObjects = child->retrieve(bounds, searchDepth);
-				foundObjects.insert(foundObjects.end(), childObjects.begin(), childObjects.end());
-			}
-		}
+		remove(object);
+		return;
+	}
 
+	//if the object would be inserted into the node it is already in only its bounds change
+	const sf::Uint32 currentNode = location->list;
+	const std::size_t slot = location->slot;
+	const sf::Uint32 newNode = findNode(0u, aabb);
+	if(newNode == currentNode)
+	{
+		m_nodes[currentNode].objects.setBounds(slot, aabb);
+		return;
 	}
-	//and append objects in this node
-	foundObjects.insert(foundObjects.end(), m_objects.begin(), m_objects.end());
 
-	return foundObjects;
+	removeFromNode(currentNode, slot);
+	insert(newNode, const_cast<MapObject*>(&object), aabb);
+	merge(currentNode);
+}
+
+void QuadTreeRoot::setSettings(const Settings& settings)
+{
+	m_settings = settings;
+	if(m_locations.empty()) return;
+
+	//reinsert everything so the existing nodes match the new settings
+	std::vector<const MapObject*> objects;
+	objects.reserve(m_locations.size());
+	m_locations.getObjects(objects);
+
+	clear(m_nodes[0].bounds);
+	for(auto object : objects)
+		insert(*object);
+}
+
+QuadTreeRoot::Settings QuadTreeRoot::autoTune(const sf::FloatRect& rootArea, const std::vector<sf::FloatRect>& objectBounds)
+{
+	Settings settings;
+	if(objectBounds.empty()) return settings;
+
+	std::vector<float> sizes;
+	sizes.reserve(objectBounds.size());
+	for(const auto& bounds : objectBounds)
+		sizes.push_back(std::max(std::max(bounds.width, bounds.height), 1.f));
+
+	//the typical object, and the larger ones towards the top of the range
+	const auto median = sizes.begin() + sizes.size() / 2u;
+	std::nth_element(sizes.begin(), median, sizes.end());
+	const float medianSize = *median;
+	const auto upper = sizes.begin() + (sizes.size() * 9u) / 10u;
+	std::nth_element(sizes.begin(), upper, sizes.end());
+	const float upperSize = *upper;
+
+	//split until nodes are around four times the size of a typical object, below which
+	//most objects would straddle the children. No deeper than needed to reach an average
+	//of one object per leaf if the objects were spread evenly
+	const float rootSize = std::max(rootArea.width, rootArea.height);
+	const float sizeLevels = std::log2(std::max(rootSize / (medianSize * 4.f), 1.f));
+	const float countLevels = std::log2(static_cast<float>(objectBounds.size())) / 2.f;
+	const float levels = std::ceil(std::min(sizeLevels, countLevels + 2.f));
+	settings.maxLevels = static_cast<sf::Uint16>(std::max(1.f, std::min(levels, 16.f)));
+
+	//widely varying sizes leave more objects stuck in higher nodes so allow
+	//them more before splitting, rather than splitting to no effect
+	settings.maxObjects = (upperSize > medianSize * 4.f) ? 16u : 8u;
+
+	return settings;
 }
 
-void QuadTreeNode::insert(const MapObject& object)
-{	
-	//check if an object falls completely outside a node
-	if(!object.getAABB().intersects(m_bounds)) return;
-	
-	//if node is already split add object to corresponding child node
-	//if it fits
-	if(!m_children.empty())
+QuadTreeRoot::Stats QuadTreeRoot::getStats() const
+{
+	Stats stats;
+	for(auto i = 0u; i < m_nodeCount; ++i)
 	{
-		sf::Int16 index = getIndex(object.getAABB());
-		if(index != -1)
+		const QuadTreeNode& node = m_nodes[i];
+		if(i > 0 && node.parent == -1) continue; //released by merging
+
+		stats.nodeCount++;
+		const sf::Uint32 objectCount = static_cast<sf::Uint32>(node.objects.size());
+		stats.objectCount += objectCount;
+
+		if(stats.depthHistogram.size() <= node.level)
+			stats.depthHistogram.resize(node.level + 1u);
+		stats.depthHistogram[node.level] += objectCount;
+
+		if(node.firstChild == -1)
 		{
-			m_children[index]->insert(object);
-			return;
+			stats.leafCount++;
+			stats.maxObjectsPerLeaf = std::max(stats.maxObjectsPerLeaf, objectCount);
+			stats.averageObjectsPerLeaf += static_cast<float>(objectCount);
 		}
 	}
-	//else add object to this node
-	m_objects.push_back(const_cast<MapObject*>(&object));
+	stats.averageObjectsPerLeaf /= static_cast<float>(stats.leafCount);
+	return stats;
+}
 
+std::vector<MapObject*> QuadTreeRoot::retrieve(const sf::FloatRect& bounds) const
+{
+	std::vector<MapObject*> foundObjects;
+	retrieve(bounds, foundObjects);
+	return foundObjects;
+}
+
+void QuadTreeRoot::retrieve(const sf::FloatRect& bounds, std::vector<MapObject*>& results, Query query, SpatialQueryStats* stats) const
+{
+	visit(bounds, [&results](MapObject* object)
+	{
+		results.push_back(object);
+	}, query, stats);
+}
+
+//private functions//
+void QuadTreeRoot::insert(sf::Uint32 nodeIndex, MapObject* object, const sf::FloatRect& aabb)
+{
+	nodeIndex = findNode(nodeIndex, aabb);
+	m_locations.assign(object, nodeIndex, m_nodes[nodeIndex].objects.size());
+	m_nodes[nodeIndex].objects.add(object, aabb);
 
 	//check number of objects in this node, and split if necessary
 	//adding any objects that fit to the new child node
-	if(m_objects.size() > MAX_OBJECTS && m_level < MAX_LEVELS)
+	if(m_nodes[nodeIndex].firstChild == -1
+		&& m_nodes[nodeIndex].objects.size() > m_settings.maxObjects
+		&& m_nodes[nodeIndex].level < m_settings.maxLevels)
 	{
-		//split if there are no child nodes
-		if(m_children.empty()) split();
+		split(nodeIndex);
 
-		sf::Uint16 i = 0;
-		while(i < m_objects.size())
+		//inserting into a child may split it and grow the node array, so
+		//the node is looked up again by index each time around
+		std::size_t i = 0u;
+		while(i < m_nodes[nodeIndex].objects.size())
 		{
-			sf::Int16 index = getIndex(m_objects[i]->getAABB());
+			MapObject* current = m_nodes[nodeIndex].objects[i];
+			const sf::FloatRect currentAABB = m_nodes[nodeIndex].objects.getBounds(i);
+			const sf::Int16 index = getIndex(m_nodes[nodeIndex].bounds, currentAABB);
 			if(index != -1)
 			{
-				m_children[index]->insert(*m_objects[i]);
-				m_objects.erase(m_objects.begin() + i);
+				removeFromNode(nodeIndex, i);
+				insert(m_nodes[nodeIndex].firstChild + index, current, currentAABB);
 			}
 			else
 			{
-				i++; //we only increment i when not erasing, because erasing moves
-				//everything up one index inside the vector
+				i++; //we only increment i when not removing, because removing
+				//moves the last object into this index
 			}
 		}
 	}
 }
 
-void QuadTreeNode::getVertices(std::vector<sf::Vertex>& vertices)
+sf::Uint32 QuadTreeRoot::findNode(sf::Uint32 nodeIndex, const sf::FloatRect& aabb) const
 {
-    sf::Color colour = sf::Color::Green;
-    vertices.emplace_back(sf::Vector2f(m_bounds.left, m_bounds.top), sf::Color::Transparent); //pad with breaks between quads
-    vertices.emplace_back(sf::Vector2f(m_bounds.left, m_bounds.top), colour);
-    vertices.emplace_back(sf::Vector2f(m_bounds.left + m_bounds.width, m_bounds.top), colour);
-    vertices.emplace_back(sf::Vector2f(m_bounds.left + m_bounds.width, m_bounds.top + m_bounds.height), colour);
-    vertices.emplace_back(sf::Vector2f(m_bounds.left, m_bounds.top + m_bounds.height), colour);
-    vertices.emplace_back(sf::Vector2f(m_bounds.left, m_bounds.top), colour);
-    vertices.emplace_back(sf::Vector2f(m_bounds.left, m_bounds.top), sf::Color::Transparent);
-
-    for (const auto& c : m_children)
-        c->getVertices(vertices);
+	//descend through any split nodes to the deepest which contains the object
+	sf::Int16 index = -1;
+	while(m_nodes[nodeIndex].firstChild != -1
+		&& (index = getIndex(m_nodes[nodeIndex].bounds, aabb)) != -1)
+	{
+		nodeIndex = m_nodes[nodeIndex].firstChild + index;
+	}
+	return nodeIndex;
 }
 
+void QuadTreeRoot::removeFromNode(sf::Uint32 nodeIndex, std::size_t slot)
+{
+	//order within a node doesn't matter, so swap with the last object rather than shifting
+	ObjectList& objects = m_nodes[nodeIndex].objects;
+	objects.remove(slot);
+	if(slot < objects.size())
+		m_locations.assign(objects[slot], nodeIndex, slot);
+}
 
-//private functions//
-void QuadTreeRoot::draw(sf::RenderTarget& rt, sf::RenderStates /* states */) const
+void QuadTreeRoot::merge(sf::Uint32 nodeIndex)
 {
-    std::vector<sf::Vertex> verts;
-    for (const auto& c : m_children)
-        c->getVertices(verts);
+	sf::Int32 current = nodeIndex;
+	while(current != -1)
+	{
+		QuadTreeNode& node = m_nodes[current];
+		if(node.firstChild != -1)
+		{
+			//children can only be merged if none of them are split, and
+			//there are few enough objects that the node wouldn't split again
+			std::size_t count = node.objects.size();
+			for(auto i = node.firstChild; i < node.firstChild + 4; ++i)
+			{
+				if(m_nodes[i].firstChild != -1) return;
+				count += m_nodes[i].objects.size();
+			}
+			if(count > m_settings.maxObjects) return;
 
-    rt.draw(verts.data(), verts.size(), sf::PrimitiveType::LinesStrip);
+			for(auto i = node.firstChild; i < node.firstChild + 4; ++i)
+			{
+				QuadTreeNode& child = m_nodes[i];
+				for(auto j = 0u; j < child.objects.size(); ++j)
+				{
+					m_locations.assign(child.objects[j], current, node.objects.size());
+					node.objects.add(child.objects[j], child.objects.getBounds(j));
+				}
+				child.objects.clear();
+				child.parent = -1;
+			}
+			m_freeNodes.push_back(node.firstChild);
+			node.firstChild = -1;
+		}
+		current = node.parent;
+	}
 }
 
-
-void QuadTreeNode::split(void)
+void QuadTreeRoot::split(sf::Uint32 nodeIndex)
 {
-	const float halfWidth = m_bounds.width / 2.f;
-	const float halfHeight = m_bounds.height / 2.f;
-	const float x = m_bounds.left;
-	const float y = m_bounds.top;
- 
-	m_children.push_back(std::make_shared<QuadTreeNode>(m_level + 1, sf::FloatRect(x + halfWidth, y, halfWidth, halfHeight)));
-	m_children.push_back(std::make_shared<QuadTreeNode>(m_level + 1, sf::FloatRect(x, y, halfWidth, halfHeight)));
-	m_children.push_back(std::make_shared<QuadTreeNode>(m_level + 1, sf::FloatRect(x, y + halfHeight, halfWidth, halfHeight)));
-	m_children.push_back(std::make_shared<QuadTreeNode>(m_level + 1, sf::FloatRect(x+ halfWidth, y + halfHeight, halfWidth, halfHeight)));
+	//reuse nodes released by merging, or left over from before the last clear
+	sf::Uint32 firstChild = m_nodeCount;
+	if(!m_freeNodes.empty())
+	{
+		firstChild = m_freeNodes.back();
+		m_freeNodes.pop_back();
+	}
+	else
+	{
+		m_nodeCount += 4u;
+		if(m_nodes.size() < m_nodeCount)
+			m_nodes.resize(m_nodeCount);
+	}
+
+	QuadTreeNode& node = m_nodes[nodeIndex];
+	node.firstChild = firstChild;
+
+	const float halfWidth = node.bounds.width / 2.f;
+	const float halfHeight = node.bounds.height / 2.f;
+	const float x = node.bounds.left;
+	const float y = node.bounds.top;
+	const std::array<sf::FloatRect, 4u> childBounds = 
+	{{
+		sf::FloatRect(x + halfWidth, y, halfWidth, halfHeight),
+		sf::FloatRect(x, y, halfWidth, halfHeight),
+		sf::FloatRect(x, y + halfHeight, halfWidth, halfHeight),
+		sf::FloatRect(x + halfWidth, y + halfHeight, halfWidth, halfHeight)
+	}};
+
+	for(auto i = 0u; i < 4u; ++i)
+	{
+		QuadTreeNode& child = m_nodes[firstChild + i];
+		child.bounds = childBounds[i];
+		child.firstChild = -1;
+		child.parent = nodeIndex;
+		child.level = node.level + 1;
+		child.objects.clear();
+	}
 }
 
-sf::Int16 QuadTreeNode::getIndex(const sf::FloatRect& bounds)
+sf::Int16 QuadTreeRoot::getIndex(const sf::FloatRect& nodeBounds, const sf::FloatRect& bounds)
 {
 	sf::Int16 index = -1;
-	float verticalMidpoint = m_bounds.left + (m_bounds.width / 2.f);
-	float horizontalMidpoint = m_bounds.top + (m_bounds.height / 2.f);
+	float verticalMidpoint = nodeBounds.left + (nodeBounds.width / 2.f);
+	float horizontalMidpoint = nodeBounds.top + (nodeBounds.height / 2.f);
  
 	//Object can completely fit within the top quadrants
 	bool topQuadrant = (bounds.top < horizontalMidpoint && bounds.top + bounds.height < horizontalMidpoint);
@@ -211,3 +381,26 @@ sf::Int16 QuadTreeNode::getIndex(const sf::FloatRect& bounds)
 	}
 	return index;
 }
+
+void QuadTreeRoot::draw(sf::RenderTarget& rt, sf::RenderStates /* states */) const
+{
+	//outline every node below the root, padded with breaks between quads
+    const sf::Color colour = sf::Color::Green;
+    std::vector<sf::Vertex> vertices;
+	vertices.reserve((m_nodeCount - 1u) * 7u);
+	for(auto i = 1u; i < m_nodeCount; ++i)
+	{
+		if(m_nodes[i].parent == -1) continue; //released by merging
+
+		const sf::FloatRect& bounds = m_nodes[i].bounds;
+		vertices.emplace_back(sf::Vector2f(bounds.left, bounds.top), sf::Color::Transparent);
+		vertices.emplace_back(sf::Vector2f(bounds.left, bounds.top), colour);
+		vertices.emplace_back(sf::Vector2f(bounds.left + bounds.width, bounds.top), colour);
+		vertices.emplace_back(sf::Vector2f(bounds.left + bounds.width, bounds.top + bounds.height), colour);
+		vertices.emplace_back(sf::Vector2f(bounds.left, bounds.top + bounds.height), colour);
+		vertices.emplace_back(sf::Vector2f(bounds.left, bounds.top), colour);
+		vertices.emplace_back(sf::Vector2f(bounds.left, bounds.top), sf::Color::Transparent);
+	}
+
+    rt.draw(vertices.data(), vertices.size(), sf::PrimitiveType::LinesStrip);
+}
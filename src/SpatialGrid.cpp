@@ -0,0 +1,206 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+Zlib License:
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+#include <tmx/SpatialGrid.hpp>
+
+#include <SFML/Graphics/RenderTarget.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace tmx;
+
+namespace
+{
+	//cells are made larger if the grid would need more than this many
+	const sf::Uint32 maxCells = 1u << 20u;
+}
+
+SpatialGrid::SpatialGrid(const sf::FloatRect& bounds, const sf::Vector2f& cellSize)
+	: m_cellSize	(cellSize),
+	m_nextCellSize	(cellSize)
+{
+	clear(bounds);
+}
+
+//public
+void SpatialGrid::setCellSize(const sf::Vector2f& size)
+{
+	assert(size.x > 0.f && size.y > 0.f);
+	m_nextCellSize = size;
+}
+
+void SpatialGrid::clear(const sf::FloatRect& newBounds)
+{
+	m_bounds = newBounds;
+	m_cellSize = m_nextCellSize;
+
+	auto countCells = [this]()
+	{
+		m_cellCount.x = std::max(1, static_cast<int>(std::ceil(m_bounds.width / m_cellSize.x)));
+		m_cellCount.y = std::max(1, static_cast<int>(std::ceil(m_bounds.height / m_cellSize.y)));
+	};
+	countCells();
+	while(static_cast<sf::Uint32>(m_cellCount.x) * static_cast<sf::Uint32>(m_cellCount.y) > maxCells)
+	{
+		m_cellSize *= 2.f;
+		countCells();
+	}
+
+	//empty the cells but keep their storage for the next rebuild
+	for(auto& cell : m_cells)
+		cell.clear();
+	m_cells.resize(m_cellCount.x * m_cellCount.y + 1u);
+	m_locations.clear();
+}
+
+void SpatialGrid::insert(const MapObject& object)
+{
+	if(m_locations.find(&object))
+	{
+		update(object);
+		return;
+	}
+
+	const sf::FloatRect aabb = object.getAABB();
+	const sf::Uint32 index = getCellIndex(aabb);
+	m_locations.assign(&object, index, m_cells[index].size());
+	m_cells[index].add(const_cast<MapObject*>(&object), aabb);
+}
+
+bool SpatialGrid::remove(const MapObject& object)
+{
+	const auto location = m_locations.find(&object);
+	if(!location) return false;
+
+	const sf::Uint32 cellIndex = location->list;
+	const std::size_t slot = location->slot;
+	m_locations.erase(&object);
+	removeFromCell(cellIndex, slot);
+	return true;
+}
+
+void SpatialGrid::update(const MapObject& object)
+{
+	const auto location = m_locations.find(&object);
+	if(!location)
+	{
+		insert(object);
+		return;
+	}
+
+	const sf::FloatRect aabb = object.getAABB();
+	const sf::Uint32 index = getCellIndex(aabb);
+	const sf::Uint32 cellIndex = location->list;
+	const std::size_t slot = location->slot;
+	if(index == cellIndex)
+	{
+		m_cells[index].setBounds(slot, aabb);
+	}
+	else
+	{
+		removeFromCell(cellIndex, slot);
+		m_locations.assign(&object, index, m_cells[index].size());
+		m_cells[index].add(const_cast<MapObject*>(&object), aabb);
+	}
+}
+
+std::vector<MapObject*> SpatialGrid::retrieve(const sf::FloatRect& bounds) const
+{
+	std::vector<MapObject*> foundObjects;
+	retrieve(bounds, foundObjects);
+	return foundObjects;
+}
+
+void SpatialGrid::retrieve(const sf::FloatRect& bounds, std::vector<MapObject*>& results, Query query, SpatialQueryStats* stats) const
+{
+	visit(bounds, [&results](MapObject* object)
+	{
+		results.push_back(object);
+	}, query, stats);
+}
+
+//private
+sf::Uint32 SpatialGrid::getCellIndex(const sf::FloatRect& aabb) const
+{
+	//objects which could reach further than the neighbouring cells are kept apart
+	if(aabb.width > m_cellSize.x || aabb.height > m_cellSize.y)
+		return static_cast<sf::Uint32>(m_cells.size() - 1u);
+
+	const float centreX = aabb.left + aabb.width / 2.f;
+	const float centreY = aabb.top + aabb.height / 2.f;
+	const int x = static_cast<int>(std::floor((centreX - m_bounds.left) / m_cellSize.x));
+	const int y = static_cast<int>(std::floor((centreY - m_bounds.top) / m_cellSize.y));
+	return std::max(0, std::min(y, m_cellCount.y - 1)) * m_cellCount.x + std::max(0, std::min(x, m_cellCount.x - 1));
+}
+
+void SpatialGrid::getCellRange(const sf::FloatRect& bounds, sf::Vector2i& start, sf::Vector2i& end) const
+{
+	//objects in a cell are no more than half a cell larger than it, so
+	//widening the area by half a cell finds all those which may overlap it
+	const float left = (bounds.left - m_bounds.left - m_cellSize.x / 2.f) / m_cellSize.x;
+	const float top = (bounds.top - m_bounds.top - m_cellSize.y / 2.f) / m_cellSize.y;
+	const float right = (bounds.left + bounds.width - m_bounds.left + m_cellSize.x / 2.f) / m_cellSize.x;
+	const float bottom = (bounds.top + bounds.height - m_bounds.top + m_cellSize.y / 2.f) / m_cellSize.y;
+
+	//clamped the same way as object centres, so objects stored at the edges are still found
+	start.x = std::max(0, std::min(static_cast<int>(std::floor(left)), m_cellCount.x - 1));
+	start.y = std::max(0, std::min(static_cast<int>(std::floor(top)), m_cellCount.y - 1));
+	end.x = std::max(0, std::min(static_cast<int>(std::floor(right)), m_cellCount.x - 1));
+	end.y = std::max(0, std::min(static_cast<int>(std::floor(bottom)), m_cellCount.y - 1));
+}
+
+void SpatialGrid::removeFromCell(sf::Uint32 cellIndex, std::size_t slot)
+{
+	//the last object in the cell is moved into the slot
+	ObjectList& cell = m_cells[cellIndex];
+	cell.remove(slot);
+	if(slot < cell.size())
+		m_locations.assign(cell[slot], cellIndex, slot);
+}
+
+void SpatialGrid::draw(sf::RenderTarget& rt, sf::RenderStates states) const
+{
+	//draw the lines between cells
+	const sf::Color colour = sf::Color::Green;
+	std::vector<sf::Vertex> vertices;
+	vertices.reserve((m_cellCount.x + m_cellCount.y + 2) * 2);
+	for(auto x = 0; x <= m_cellCount.x; ++x)
+	{
+		const float position = m_bounds.left + static_cast<float>(x) * m_cellSize.x;
+		vertices.emplace_back(sf::Vector2f(position, m_bounds.top), colour);
+		vertices.emplace_back(sf::Vector2f(position, m_bounds.top + m_cellCount.y * m_cellSize.y), colour);
+	}
+	for(auto y = 0; y <= m_cellCount.y; ++y)
+	{
+		const float position = m_bounds.top + static_cast<float>(y) * m_cellSize.y;
+		vertices.emplace_back(sf::Vector2f(m_bounds.left, position), colour);
+		vertices.emplace_back(sf::Vector2f(m_bounds.left + m_cellCount.x * m_cellSize.x, position), colour);
+	}
+	rt.draw(vertices.data(), vertices.size(), sf::PrimitiveType::Lines, states);
+}
@@ -0,0 +1,186 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+Zlib License:
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+#include <tmx/StaticRTree.hpp>
+
+#include <SFML/Graphics/RenderTarget.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+using namespace tmx;
+
+namespace
+{
+	struct Entry final
+	{
+		float left, top, right, bottom;
+		sf::Uint32 index; //of the object or node the entry represents
+	};
+
+	//sorts entries by the x coordinate of their centres, then cuts them into vertical slices
+	//and sorts each slice by y, so that each run of nodeCapacity entries forms a compact tile
+	void sortTiles(std::vector<Entry>& entries, std::size_t nodeCapacity)
+	{
+		std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b)
+		{
+			return a.left + a.right < b.left + b.right;
+		});
+
+		const std::size_t nodeCount = (entries.size() + nodeCapacity - 1u) / nodeCapacity;
+		const std::size_t sliceSize = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<float>(nodeCount)))) * nodeCapacity;
+		for(std::size_t start = 0u; start < entries.size(); start += sliceSize)
+		{
+			std::sort(entries.begin() + start, entries.begin() + std::min(start + sliceSize, entries.size()), [](const Entry& a, const Entry& b)
+			{
+				return a.top + a.bottom < b.top + b.bottom;
+			});
+		}
+	}
+}
+
+//public
+void StaticRTree::build(const std::vector<const MapObject*>& objects)
+{
+	clear();
+	if(objects.empty()) return;
+
+	std::vector<Entry> entries;
+	entries.reserve(objects.size());
+	for(std::size_t i = 0u; i < objects.size(); ++i)
+	{
+		const sf::FloatRect aabb = objects[i]->getAABB();
+		entries.push_back({aabb.left, aabb.top, aabb.left + aabb.width, aabb.top + aabb.height, static_cast<sf::Uint32>(i)});
+	}
+	sortTiles(entries, maxEntries);
+	for(const auto& entry : entries)
+	{
+		m_objects.add(const_cast<MapObject*>(objects[entry.index]),
+			sf::FloatRect(entry.left, entry.top, entry.right - entry.left, entry.bottom - entry.top));
+	}
+
+	//packs each run of entries into a node, whose children start at the given offset
+	auto packLevel = [this, &entries](sf::Uint32 childOffset, bool leaf)
+	{
+		for(std::size_t first = 0u; first < entries.size(); first += maxEntries)
+		{
+			const std::size_t last = std::min(first + maxEntries, entries.size());
+			Node node;
+			node.left = entries[first].left;
+			node.top = entries[first].top;
+			node.right = entries[first].right;
+			node.bottom = entries[first].bottom;
+			for(auto i = first + 1u; i < last; ++i)
+			{
+				node.left = std::min(node.left, entries[i].left);
+				node.top = std::min(node.top, entries[i].top);
+				node.right = std::max(node.right, entries[i].right);
+				node.bottom = std::max(node.bottom, entries[i].bottom);
+			}
+			node.first = childOffset + static_cast<sf::Uint32>(first);
+			node.count = static_cast<sf::Uint32>(last - first);
+			node.leaf = leaf;
+			m_nodes.push_back(node);
+		}
+	};
+	packLevel(0u, true);
+
+	//pack each level into the one above until only the root remains
+	std::size_t levelStart = 0u;
+	std::vector<Node> sortedNodes;
+	while(m_nodes.size() - levelStart > 1u)
+	{
+		entries.clear();
+		for(auto i = levelStart; i < m_nodes.size(); ++i)
+		{
+			const Node& node = m_nodes[i];
+			entries.push_back({node.left, node.top, node.right, node.bottom, static_cast<sf::Uint32>(i)});
+		}
+		sortTiles(entries, maxEntries);
+
+		//reorder the level so the children of each parent are consecutive
+		sortedNodes.clear();
+		for(const auto& entry : entries)
+			sortedNodes.push_back(m_nodes[entry.index]);
+		std::copy(sortedNodes.begin(), sortedNodes.end(), m_nodes.begin() + levelStart);
+
+		const std::size_t nextLevel = m_nodes.size();
+		packLevel(static_cast<sf::Uint32>(levelStart), false);
+		levelStart = nextLevel;
+	}
+
+	m_sortedObjects = objects;
+	std::sort(m_sortedObjects.begin(), m_sortedObjects.end(), std::less<const MapObject*>());
+}
+
+void StaticRTree::clear()
+{
+	m_nodes.clear();
+	m_objects.clear();
+	m_sortedObjects.clear();
+}
+
+bool StaticRTree::contains(const MapObject& object) const
+{
+	return std::binary_search(m_sortedObjects.begin(), m_sortedObjects.end(), &object, std::less<const MapObject*>());
+}
+
+void StaticRTree::retrieve(const sf::FloatRect& bounds, std::vector<MapObject*>& results, Query query, SpatialQueryStats* stats) const
+{
+	visit(bounds, [&results](MapObject* object)
+	{
+		results.push_back(object);
+	}, query, stats);
+}
+
+//private
+void StaticRTree::draw(sf::RenderTarget& rt, sf::RenderStates states) const
+{
+	//draw the outline of each leaf
+	const sf::Color colour = sf::Color::Cyan;
+	std::vector<sf::Vertex> vertices;
+	for(const auto& node : m_nodes)
+	{
+		if(!node.leaf) continue;
+
+		const sf::Vector2f corners[] =
+		{
+			sf::Vector2f(node.left, node.top),
+			sf::Vector2f(node.right, node.top),
+			sf::Vector2f(node.right, node.bottom),
+			sf::Vector2f(node.left, node.bottom)
+		};
+		for(auto i = 0u; i < 4u; ++i)
+		{
+			vertices.emplace_back(corners[i], colour);
+			vertices.emplace_back(corners[(i + 1u) % 4u], colour);
+		}
+	}
+	rt.draw(vertices.data(), vertices.size(), sf::PrimitiveType::Lines, states);
+}
@@ -0,0 +1,139 @@
+/*********************************************************************
+Matt Marchant 2013 - 2016
+SFML Tiled Map Loader - https://github.com/bjorn/tiled/wiki/TMX-Map-Format
+						http://trederia.blogspot.com/2013/05/tiled-map-loader-for-sfml.html
+
+Zlib License:
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+   you must not claim that you wrote the original software.
+   If you use this software in a product, an acknowledgment
+   in the product documentation would be appreciated but
+   is not required.
+
+2. Altered source versions must be plainly marked as such,
+   and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+   source distribution.
+*********************************************************************/
+
+#include <tmx/WorkerPool.hpp>
+
+using namespace tmx;
+
+WorkerPool::WorkerPool()
+	: m_task		(nullptr),
+	m_count			(0u),
+	m_threadCount	(0u),
+	m_pending		(0u),
+	m_batch			(0u),
+	m_stop			(false)
+{
+
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_startCondition.notify_all();
+	for(auto& worker : m_workers)
+		worker.join();
+}
+
+//public
+void WorkerPool::run(sf::Uint32 threadCount, std::size_t count, const Task& task)
+{
+	if(threadCount < 2u || count < 2u)
+	{
+		task(0u, 0u, count);
+		return;
+	}
+
+	std::lock_guard<std::mutex> runLock(m_runMutex);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		//new workers wait for the batch after the current one
+		while(m_workers.size() < threadCount - 1u)
+			m_workers.emplace_back(&WorkerPool::work, this, static_cast<sf::Uint32>(m_workers.size() + 1u), m_batch);
+
+		m_task = &task;
+		m_count = count;
+		m_threadCount = threadCount;
+		m_pending = threadCount - 1u;
+		m_batch++;
+	}
+	m_startCondition.notify_all();
+
+	//the workers refer to task, so must finish before this returns even if it throws
+	std::exception_ptr error;
+	try
+	{
+		task(0u, 0u, count / threadCount);
+	}
+	catch(...)
+	{
+		error = std::current_exception();
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCondition.wait(lock, [this]{ return m_pending == 0u; });
+	m_task = nullptr;
+	if(!error) error = m_error;
+	m_error = nullptr;
+	lock.unlock();
+
+	if(error) std::rethrow_exception(error);
+}
+
+std::size_t WorkerPool::getWorkerCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_workers.size();
+}
+
+//private
+void WorkerPool::work(sf::Uint32 thread, sf::Uint64 batch)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for(;;)
+	{
+		m_startCondition.wait(lock, [this, batch]{ return m_stop || m_batch != batch; });
+		if(m_stop) return;
+		batch = m_batch;
+
+		//workers beyond those wanted for this batch sit it out
+		if(thread >= m_threadCount) continue;
+
+		const Task& task = *m_task;
+		const std::size_t first = m_count * thread / m_threadCount;
+		const std::size_t last = m_count * (thread + 1u) / m_threadCount;
+		lock.unlock();
+		std::exception_ptr error;
+		try
+		{
+			task(thread, first, last);
+		}
+		catch(...)
+		{
+			error = std::current_exception();
+		}
+		lock.lock();
+
+		if(error && !m_error) m_error = error;
+
+		if(--m_pending == 0u)
+			m_doneCondition.notify_one();
+	}
+}